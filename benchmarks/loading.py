@@ -0,0 +1,264 @@
+"""
+Microbenchmarks for the model, texture and scene building paths: gl_load_stitched_model and its parse and build halves,
+_load_node (through gl_load_mdl), Model.box, Boundary._build_nd, Texture.from_tpc and Scene.buildCache, the frame time
+of an unchanged scene against one whose GIT is diffed every frame, the draw calls and texture binds of a frame with
+texture arrays and instancing turned on one after the other and with VIS culling on and off, and the first frame that
+meets unseen textures with and without texture workers. Runs in a headless context and uses fixed fixtures only: the
+predefined gizmo models, textures generated from a seeded random number generator and synthetic modules, so no game
+installation is needed.
+
+    python -m benchmarks.loading [--repeat 20] [--output results.json]
+
+Every entry reports the fastest and the median of --repeat runs in microseconds. Mesa's llvmpipe is selected unless
+LIBGL_ALWAYS_SOFTWARE is already set, so results from different machines running the same Mesa are comparable.
+"""
+from __future__ import annotations
+
+from pykotor.gl import headless
+
+headless.configure()
+
+import argparse
+import json
+import math
+import statistics
+import sys
+import time
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+import numpy
+from OpenGL.GL import glGetString, glDeleteTextures
+from OpenGL.raw.GL.VERSION.GL_1_0 import GL_RENDERER, GL_VERSION, glFinish
+
+from glm import vec3
+
+from pykotor.common.geometry import Vector3
+from pykotor.common.stream import BinaryReader
+from pykotor.resource.formats.tpc import TPC, TPCTextureFormat
+
+from pykotor.gl.models import predefined_mdl
+from pykotor.gl.models.mdl import Boundary
+from pykotor.gl.models.read_mdl import gl_load_mdl, gl_load_stitched_model, parse_stitched_model, \
+    build_stitched_model
+from pykotor.gl.shader import Texture
+from pykotor.gl.synthetic import SyntheticModule
+from pykotor.gl.transcode import compress_dxt1, compress_dxt5, downsample
+
+MODELS = ["store", "waypoint", "sound", "camera", "trigger", "encounter", "entry", "unknown", "cursor"]
+TEXTURE_SIZES = [256, 1024]
+INSTANCES = [100, 1000, 2000]
+# (name, texture_arrays, instancing) of the configurations whose draw calls and texture binds are counted
+BATCHING = [("per_mesh", False, False), ("texture_arrays", True, False), ("instanced", True, True)]
+# Unseen textures the first frame of a module meets, and their size
+FIRST_FRAME_TEXTURES = 32
+FIRST_FRAME_TEXTURE_SIZE = 512
+
+
+def _measure(function: Callable[[], Any], repeat: int, cleanup: Optional[Callable[[Any], None]] = None) \
+        -> Dict[str, float]:
+    times = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = function()
+        times.append(time.perf_counter() - start)
+        if cleanup is not None:
+            cleanup(result)
+    return {"min_us": min(times) * 1e6, "median_us": statistics.median(times) * 1e6}
+
+
+def _model_data(name: str) -> Tuple[bytes, bytes]:
+    return getattr(predefined_mdl, name.upper() + "_MDL_DATA"), getattr(predefined_mdl, name.upper() + "_MDX_DATA")
+
+
+def fixture_tpc(size: int, texture_format: TPCTextureFormat, seed: int = 0) -> TPC:
+    """
+    Returns a square texture with a full mip chain of smooth noise.
+    """
+    rng = numpy.random.default_rng(seed)
+    coarse = rng.integers(0, 256, (size // 16, size // 16, 4), numpy.uint8)
+    image = numpy.repeat(numpy.repeat(coarse, 16, axis=0), 16, axis=1)
+    image = (image.astype(numpy.uint16) + rng.integers(0, 32, image.shape, numpy.uint16)).clip(0, 255)
+    image = image.astype(numpy.uint8)
+
+    encode = {
+        TPCTextureFormat.RGBA: lambda level: level.tobytes(),
+        TPCTextureFormat.DXT1: lambda level: compress_dxt1(numpy.ascontiguousarray(level[..., :3])),
+        TPCTextureFormat.DXT5: compress_dxt5,
+    }[texture_format]
+    mipmaps = [encode(image)]
+    while image.shape[0] > 1:
+        image = downsample(image)
+        mipmaps.append(encode(image))
+
+    tpc = TPC()
+    tpc.set(size, size, mipmaps, texture_format)
+    return tpc
+
+
+def run(repeat: int, seed: int = 0) -> Dict[str, Dict[str, float]]:
+    context = headless.HeadlessContext(64, 64)
+    scene = context.scene(texture_workers=0)
+    results = {}
+
+    def release(model) -> None:
+        model.release()
+
+    for name in MODELS:
+        mdl, mdx = _model_data(name)
+        results["gl_load_stitched_model/" + name] = _measure(
+            lambda: gl_load_stitched_model(scene, BinaryReader.from_bytes(mdl, 12), BinaryReader.from_bytes(mdx)),
+            repeat, release)
+        results["parse_stitched_model/" + name] = _measure(
+            lambda: parse_stitched_model(BinaryReader.from_bytes(mdl, 12), BinaryReader.from_bytes(mdx)), repeat)
+        parsed = parse_stitched_model(BinaryReader.from_bytes(mdl, 12), BinaryReader.from_bytes(mdx))
+        results["build_stitched_model/" + name] = _measure(lambda: build_stitched_model(scene, parsed), repeat, release)
+        results["load_node/" + name] = _measure(
+            lambda: gl_load_mdl(scene, BinaryReader.from_bytes(mdl, 12), BinaryReader.from_bytes(mdx)), repeat, release)
+
+        model = gl_load_stitched_model(scene, BinaryReader.from_bytes(mdl, 12), BinaryReader.from_bytes(mdx))
+        results["model_box/" + name] = _measure(model.box, repeat)
+        model.release()
+
+    for count in [16, 256]:
+        points = [Vector3(math.cos(i / count * math.tau) * 10, math.sin(i / count * math.tau) * 10, 0.0)
+                  for i in range(count)]
+        results["boundary_build_nd/{}".format(count)] = _measure(lambda: Boundary._build_nd(None, points), repeat)
+
+    for texture_format in [TPCTextureFormat.RGBA, TPCTextureFormat.DXT1, TPCTextureFormat.DXT5]:
+        for size in TEXTURE_SIZES:
+            tpc = fixture_tpc(size, texture_format, seed)
+
+            # glFinish makes the timing include the driver's copy of the pixels, not just queueing it
+            def upload() -> Texture:
+                texture = Texture.from_tpc(tpc)
+                glFinish()
+                return texture
+
+            results["texture_from_tpc/{}/{}".format(texture_format.name, size)] = _measure(
+                upload, repeat, lambda texture: glDeleteTextures([texture.id()]))
+
+    for instances in INSTANCES:
+        SyntheticModule.scaled(instances, seed).attach(scene)
+        results["build_cache_clear/{}".format(instances)] = _measure(lambda: scene.buildCache(clearCache=True), repeat)
+        results["build_cache_unchanged/{}".format(instances)] = _measure(scene.buildCache, repeat)
+
+        # A GIT diff on every frame is what render() did before scene updates were event driven
+        scene.frameTopDown()
+        scene.render()
+        results["frame_unchanged/{}".format(instances)] = _measure(scene.render, repeat)
+
+        def diffed_frame() -> None:
+            scene.invalidateGit()
+            scene.render()
+
+        results["frame_git_diff/{}".format(instances)] = _measure(diffed_frame, repeat)
+
+    for instances in INSTANCES:
+        for name, texture_arrays, instancing in BATCHING:
+            results["batching/{}/{}".format(name, instances)] = _count_batches(context, instances, seed,
+                                                                               texture_arrays, instancing)
+        results["vis_culling/{}".format(instances)] = _count_vis(context, instances, seed)
+
+    for workers in [0, 2]:
+        results["first_frame/workers_{}".format(workers)] = _first_frame(context, workers, min(repeat, 5), seed)
+
+    info = {"renderer": glGetString(GL_RENDERER).decode(), "version": glGetString(GL_VERSION).decode()}
+    context.release()
+    return {"context": info, "results": results}
+
+
+def _count_batches(context: headless.HeadlessContext, instances: int, seed: int, texture_arrays: bool,
+                   instancing: bool) -> Dict[str, float]:
+    """
+    Returns the draw calls and texture binds of a frame of a synthetic module seen from above.
+    """
+    scene = context.scene(texture_workers=0, texture_arrays=texture_arrays)
+    scene.instancing = instancing
+    SyntheticModule.scaled(instances, seed).attach(scene)
+    scene.waitForPrefetch()
+    scene.frameTopDown(0.05)
+    scene.render()
+    scene.waitForTextures()
+    scene.render()
+    frame = scene.stats.frames[-1]
+    counts = {"draws": frame.draws, "texture_binds": frame.texture_binds, "triangles": frame.triangles}
+    scene.release()
+    return counts
+
+
+def _count_vis(context: headless.HeadlessContext, instances: int, seed: int) -> Dict[str, float]:
+    """
+    Returns the draw calls of a frame from the middle room of a synthetic module with VIS culling on and off.
+    """
+    scene = context.scene(texture_workers=0)
+    module = SyntheticModule.scaled(instances, seed, vis_range=1)
+    module.attach(scene)
+    # Rooms are indexed with provisional bounds until their models are built by the first frame
+    scene.render()
+    room = scene.layout.rooms[len(scene.layout.rooms) // 2]
+    position = vec3(room.position.x, room.position.y, room.position.z)
+    for obj in scene.spatial.query_sphere(position, 1.0):
+        if obj.data is room:
+            x0, y0, z0, x1, y1, z1 = scene.spatial.bounds(obj)
+            position = vec3((x0 + x1) / 2, (y0 + y1) / 2, (z0 + z1) / 2)
+    # With no distance the eye is at the camera's position, inside the room
+    scene.camera.x, scene.camera.y, scene.camera.z = position.x, position.y, position.z
+    scene.camera.distance = 0.0
+
+    counts = {}
+    for culling in [True, False]:
+        scene.vis_culling = culling
+        scene.render()
+        counts["draws_on" if culling else "draws_off"] = scene.stats.frames[-1].draws
+    counts["rooms"] = len(scene.layout.rooms)
+    scene.release()
+    return counts
+
+
+def _first_frame(context: headless.HeadlessContext, workers: int, repeat: int, seed: int) -> Dict[str, float]:
+    """
+    Times the first frame of a module with unseen textures and the time until they are all resident.
+    """
+    tpcs = {"syn_tex_{}".format(i): fixture_tpc(FIRST_FRAME_TEXTURE_SIZE, TPCTextureFormat.DXT5, seed + i)
+            for i in range(FIRST_FRAME_TEXTURES)}
+    frames, resident = [], []
+    for _ in range(repeat):
+        scene = context.scene(texture_workers=workers)
+        module = SyntheticModule(rooms=16, seed=seed)
+        module.textures.update(tpcs)
+        module.attach(scene)
+        scene.waitForPrefetch()
+        scene.render()
+        glFinish()
+
+        start = time.perf_counter()
+        for name in tpcs:
+            scene.texture(name)
+        scene.render()
+        glFinish()
+        frames.append(time.perf_counter() - start)
+        scene.waitForTextures()
+        glFinish()
+        resident.append(time.perf_counter() - start)
+        scene.release()
+    return {"frame_min_us": min(frames) * 1e6, "frame_median_us": statistics.median(frames) * 1e6,
+            "resident_median_us": statistics.median(resident) * 1e6}
+
+
+def main(argv: List[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--repeat", type=int, default=20)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", help="write the results to this file instead of stdout")
+    args = parser.parse_args(argv)
+
+    text = json.dumps({"benchmark": "loading", **run(args.repeat, args.seed)}, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text)
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,105 @@
+"""
+Replays a recorded camera path against a module in a headless context and reports frame time percentiles, per-pass
+statistics and image checksums at keyframes, so a performance change and a visual regression show up in the same run.
+
+    python -m benchmarks.replay --installation <game directory> --module m01aa --path path.json [--keyframes 30]
+    python -m benchmarks.replay --synthetic 10000 [--frames 240] [--reference previous.json] [--output results.json]
+    python -m benchmarks.replay --synthetic 2000 --texture-arrays [--no-instancing]
+
+Without --path the camera orbits the middle of the layout. Paths are recorded with CameraPath.record() once per frame
+and saved with CameraPath.save(). With --reference, keyframes whose checksum differs from the reference results are
+listed under "mismatches" and the exit status is 1. The draws and texture_binds counters under "stats" compare batching
+settings: run once with --texture-arrays --no-instancing and once with --texture-arrays, and VIS culling: run once
+as is and once with --no-vis-culling. With --no-warmup the first frames meet every model and texture unloaded, so
+"max" under "frame_ms" is the first-frame stall; compare it with the default and with --texture-workers 2.
+"""
+from __future__ import annotations
+
+from pykotor.gl import headless
+
+headless.configure()
+
+import argparse
+import json
+import sys
+from typing import List
+
+from pykotor.common.module import Module
+from pykotor.extract.installation import Installation
+
+from pykotor.gl.camera_path import CameraPath, replay, compare_checksums
+from pykotor.gl.synthetic import SyntheticModule
+
+
+def main(argv: List[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--installation", help="path to the game directory")
+    parser.add_argument("--module", help="root of the module to replay in, such as m01aa")
+    parser.add_argument("--synthetic", type=int, help="replay in a synthetic module of about this many objects")
+    parser.add_argument("--path", help="camera path recorded with CameraPath.save()")
+    parser.add_argument("--frames", type=int, default=240, help="length of the orbit used when there is no --path")
+    parser.add_argument("--save-path", help="write the camera path that was replayed to this file")
+    parser.add_argument("--keyframes", type=int, default=30, help="checksum the image every this many frames; 0 to "
+                                                                  "turn checksums off")
+    parser.add_argument("--reference", help="results of an earlier run to compare checksums against")
+    parser.add_argument("--size", type=int, nargs=2, default=[1280, 720], metavar=("WIDTH", "HEIGHT"))
+    parser.add_argument("--texture-arrays", action="store_true", help="pack textures into texture arrays")
+    parser.add_argument("--no-instancing", action="store_true", help="draw every copy of a mesh with its own call")
+    parser.add_argument("--no-vis-culling", action="store_true", help="draw rooms the module's VIS hides")
+    parser.add_argument("--texture-workers", type=int, default=0, help="threads loading textures; 0 loads them in "
+                                                                       "the frame that first draws them")
+    parser.add_argument("--no-warmup", action="store_true", help="time the path from a cold start instead of after "
+                                                                 "rendering it once")
+    parser.add_argument("--output", help="write the results to this file instead of stdout")
+    args = parser.parse_args(argv)
+
+    context = headless.HeadlessContext(*args.size)
+    if args.synthetic is not None:
+        scene = context.scene(texture_arrays=args.texture_arrays, texture_workers=args.texture_workers)
+        scene.instancing = not args.no_instancing
+        scene.vis_culling = not args.no_vis_culling
+        SyntheticModule.scaled(args.synthetic).attach(scene)
+        name = "synthetic-{}".format(args.synthetic)
+    elif args.installation and args.module:
+        installation = Installation(args.installation)
+        scene = context.scene(installation=installation, texture_arrays=args.texture_arrays,
+                              texture_workers=args.texture_workers)
+        scene.instancing = not args.no_instancing
+        scene.vis_culling = not args.no_vis_culling
+        scene.setModule(Module(args.module, installation))
+        name = args.module
+    else:
+        parser.error("either --synthetic or both --installation and --module are required")
+        return
+
+    if args.path:
+        path = CameraPath.load(args.path)
+    else:
+        bounds = scene.roomBounds()
+        center = (bounds[0] + bounds[1]) / 2 if bounds is not None else scene.camera.truePosition()
+        radius = max(1.0, (bounds[1].x - bounds[0].x) / 4) if bounds is not None else 10.0
+        path = CameraPath.orbit(center, radius, args.frames)
+    if args.save_path:
+        path.save(args.save_path)
+
+    results = {"benchmark": "replay", "module": name, "texture_arrays": args.texture_arrays,
+               "instancing": scene.instancing, "vis_culling": scene.vis_culling,
+               "texture_workers": args.texture_workers,
+               **replay(scene, path, keyframe_interval=args.keyframes, warmup=not args.no_warmup)}
+    if args.reference:
+        with open(args.reference) as file:
+            results["mismatches"] = compare_checksums(results, json.load(file))
+    context.release()
+
+    text = json.dumps(results, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text)
+    else:
+        print(text)
+    if results.get("mismatches"):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,102 @@
+"""
+Scaling sweep of the scene over synthetic modules from 10 to 100,000 objects. For each size it times
+Scene.buildCache, render and pick, and measures the Python heap held by the scene's objects and its video memory use.
+pick_ms renders the ID pass on every call; pick_cached_ms only reads the retained pick buffer back.
+
+    python -m benchmarks.scale [--counts 10 100 1000 10000 100000] [--frames 10] [--output results.json]
+
+Each result is one point of the curves: objects against milliseconds per call (median) and megabytes. Rendering is
+headless through Mesa's llvmpipe unless LIBGL_ALWAYS_SOFTWARE is already set.
+"""
+from __future__ import annotations
+
+from pykotor.gl import headless
+
+headless.configure()
+
+import argparse
+import gc
+import json
+import statistics
+import sys
+import time
+import tracemalloc
+from typing import Any, Callable, Dict, List
+
+from pykotor.gl.scene import Scene
+from pykotor.gl.synthetic import SyntheticModule
+
+
+def _median_ms(function: Callable[[], Any], repeat: int) -> float:
+    times = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        function()
+        times.append(time.perf_counter() - start)
+    return statistics.median(times) * 1000
+
+
+def run(scene: Scene, count: int, frames: int, seed: int = 0) -> Dict[str, Any]:
+    module = SyntheticModule.scaled(count, seed)
+
+    # The heap is measured on a first build so it includes the render objects and the models they load
+    scene.setModule(None)
+    gc.collect()
+    tracemalloc.start()
+    module.attach(scene)
+    python_bytes = tracemalloc.get_traced_memory()[0]
+    tracemalloc.stop()
+
+    results = {"objects": module.object_count()}
+    results["build_cache_ms"] = _median_ms(lambda: scene.buildCache(clearCache=True), 3)
+    results["build_cache_unchanged_ms"] = _median_ms(scene.buildCache, frames)
+
+    scene.frameTopDown()
+    scene.render()
+    scene.waitForTextures()
+    scene.render()
+    scene.stats.clear()
+    results["render_ms"] = _median_ms(scene.render, frames)
+    results["render_stats"] = scene.stats.summary()
+
+    x, y = scene.camera.width // 2, scene.camera.height // 2
+
+    def pick():
+        # Dropping the key makes every pick render the ID pass again instead of reading the retained buffer
+        if scene.pick_buffer is not None:
+            scene.pick_buffer.key = None
+        scene.pick(x, y)
+
+    results["pick_ms"] = _median_ms(pick, frames)
+    results["pick_cached_ms"] = _median_ms(lambda: scene.pick(x, y), frames)
+
+    results["python_mb"] = python_bytes / (1 << 20)
+    results["vram_mb"] = scene.vramUsage() / (1 << 20)
+    return results
+
+
+def main(argv: List[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--counts", type=int, nargs="+", default=[10, 100, 1000, 10000, 100000])
+    parser.add_argument("--frames", type=int, default=10, help="renders and picks timed at each size")
+    parser.add_argument("--size", type=int, nargs=2, default=[1280, 720], metavar=("WIDTH", "HEIGHT"))
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", help="write the results to this file instead of stdout")
+    args = parser.parse_args(argv)
+
+    context = headless.HeadlessContext(*args.size)
+    scene = context.scene(texture_workers=0)
+    scene.show_cursor = False
+    results = [run(scene, count, args.frames, args.seed) for count in args.counts]
+    context.release()
+
+    text = json.dumps({"benchmark": "scale", "results": results}, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text)
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,106 @@
+"""
+Scaling benchmark for the scene's spatial index. Builds a LooseOctree over randomly placed boxes spread across a
+module-sized area and times inserts, moves and each query type against a linear scan over the same boxes.
+
+    python -m benchmarks.spatial [--counts 100 1000 10000 100000] [--output results.json]
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import math
+import random
+import sys
+import time
+from typing import Dict, List, Tuple
+
+import glm
+from glm import vec3
+
+from pykotor.gl.spatial import LooseOctree, frustum_planes
+
+AREA = 2000.0
+QUERIES = 100
+
+
+def _random_box(rng: random.Random) -> Tuple[vec3, vec3]:
+    center = vec3(rng.uniform(-AREA / 2, AREA / 2), rng.uniform(-AREA / 2, AREA / 2), rng.uniform(0, 20))
+    size = vec3(rng.choice([0.5, 1.0, 2.0, 4.0, 30.0]))
+    return center - size / 2, center + size / 2
+
+
+def _timed(function, repeat: int = 1) -> float:
+    start = time.perf_counter()
+    for _ in range(repeat):
+        function()
+    return (time.perf_counter() - start) / repeat
+
+
+def run(count: int, seed: int = 0) -> Dict[str, float]:
+    rng = random.Random(seed)
+    boxes = {i: _random_box(rng) for i in range(count)}
+    tree = LooseOctree(lambda i: boxes[i])
+
+    results = {"objects": count}
+    results["insert_us"] = _timed(lambda: [tree.insert(i) for i in range(count)]) / count * 1e6
+
+    moved = rng.sample(range(count), min(count, 1000))
+    for i in moved:
+        boxes[i] = _random_box(rng)
+    results["update_us"] = _timed(lambda: [tree.update(i) for i in moved]) / len(moved) * 1e6
+
+    flat = [(i, *boxes[i]) for i in range(count)]
+
+    centers = [vec3(rng.uniform(-AREA / 2, AREA / 2), rng.uniform(-AREA / 2, AREA / 2), 10) for _ in range(QUERIES)]
+    query_size = vec3(50.0)
+
+    def scan_box():
+        for center in centers:
+            low, high = center - query_size, center + query_size
+            [i for i, a, b in flat if a.x <= high.x and b.x >= low.x and a.y <= high.y and b.y >= low.y
+             and a.z <= high.z and b.z >= low.z]
+
+    results["box_us"] = _timed(lambda: [tree.query_box(c - query_size, c + query_size) for c in centers]) \
+        / QUERIES * 1e6
+    results["box_scan_us"] = _timed(scan_box) / QUERIES * 1e6
+    results["sphere_us"] = _timed(lambda: [tree.query_sphere(c, 50.0) for c in centers]) / QUERIES * 1e6
+
+    directions = [glm.normalize(vec3(rng.uniform(-1, 1), rng.uniform(-1, 1), rng.uniform(-0.2, 0.0)))
+                  for _ in range(QUERIES)]
+    results["ray_us"] = _timed(lambda: [tree.query_ray(c, d, 200.0) for c, d in zip(centers, directions)]) \
+        / QUERIES * 1e6
+
+    projection = glm.perspective(math.radians(70), 16 / 9, 0.1, 500)
+    views = [glm.lookAt(c, c + d, vec3(0, 0, 1)) for c, d in zip(centers, directions)]
+    results["frustum_us"] = _timed(lambda: [tree.query_frustum(projection * v) for v in views]) / QUERIES * 1e6
+
+    def scan_frustum():
+        for view in views:
+            planes = frustum_planes(projection * view)
+            [i for i, a, b in flat if all(pa * (b.x if pa >= 0 else a.x) + pb * (b.y if pb >= 0 else a.y)
+                                          + pc * (b.z if pc >= 0 else a.z) + pd >= 0 for pa, pb, pc, pd in planes)]
+
+    results["frustum_scan_us"] = _timed(scan_frustum) / QUERIES * 1e6
+
+    results["remove_us"] = _timed(lambda: [tree.remove(i) for i in range(count)]) / count * 1e6
+    return results
+
+
+def main(argv: List[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--counts", type=int, nargs="+", default=[100, 1000, 10000, 100000])
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", help="write the results to this file instead of stdout")
+    args = parser.parse_args(argv)
+
+    results = [run(count, args.seed) for count in args.counts]
+    text = json.dumps({"benchmark": "spatial", "results": results}, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text)
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,133 @@
+from __future__ import annotations
+
+from concurrent.futures import Future
+from typing import Any, Dict, Generic, Hashable, List, Optional, TypeVar
+
+from pykotor.gl.shader import Shader, Texture, KOTOR_VSHADER, KOTOR_FSHADER, PICKER_VSHADER, PICKER_FSHADER, \
+    PLAIN_VSHADER, PLAIN_FSHADER
+from pykotor.gl.resources import GLResources, PROGRAM, TEXTURE
+from pykotor.gl.texture_array import TextureArrayManager
+
+from typing import TYPE_CHECKING
+if TYPE_CHECKING:
+    from pykotor.gl.scene import Scene
+
+T = TypeVar("T")
+
+
+class SharedAsset(Generic[T]):
+    """
+    A texture or model in an AssetContext and the number of scenes holding it.
+    """
+
+    def __init__(self, key: Hashable, value: T):
+        self.key: Hashable = key
+        self.value: T = value
+        self.holders: int = 1
+
+
+class AssetContext:
+    """
+    The shaders, texture arrays, textures and models shared by scenes whose GL contexts share objects, with every asset
+    deleted once the last scene holding it lets go.
+    """
+
+    def __init__(self):
+        self.resources: GLResources = GLResources()
+        self.scenes: List[Scene] = []
+        # The scene rendering right now, which meshes of shared models bind their textures and uniforms through
+        self.drawing: Optional[Scene] = None
+        self.shader: Optional[Shader] = None
+        self.plain_shader: Optional[Shader] = None
+        self.picker_shader: Optional[Shader] = None
+        self.null_texture: Optional[Texture] = None
+        self.texture_arrays: Optional[TextureArrayManager] = None
+        # Texture handles evicted by any of the scenes, with the name to load them again by once one binds them
+        self.evicted_textures: Dict[Texture, str] = {}
+        # TPCs being loaded by the texture workers of any of the scenes, keyed by the handle they go into; whichever
+        # scene renders next uploads them, so a scene that is not being drawn does not hold back the others
+        self.pending_textures: Dict[Texture, Future] = {}
+        self._assets: Dict[Hashable, SharedAsset] = {}
+        self._frame: int = 0
+
+    def __contains__(self, key: Hashable) -> bool:
+        return key in self._assets
+
+    def __len__(self) -> int:
+        return len(self._assets)
+
+    def attach(self, scene: Scene) -> None:
+        """
+        Adds a scene to the context, compiling the shaders if it is the first; its GL context must be current.
+        """
+        if not self.scenes:
+            self.shader = Shader(KOTOR_VSHADER, KOTOR_FSHADER)
+            self.plain_shader = Shader(PLAIN_VSHADER, PLAIN_FSHADER)
+            self.picker_shader = Shader(PICKER_VSHADER, PICKER_FSHADER)
+            self.null_texture = Texture.from_color()
+            for shader in (self.shader, self.plain_shader, self.picker_shader):
+                self.resources.track(PROGRAM, shader.id())
+            self.resources.track(TEXTURE, self.null_texture.id(), self.null_texture.size)
+        self.scenes.append(scene)
+
+    def detach(self, scene: Scene) -> None:
+        """
+        Removes a scene that has released its assets, deleting the shaders and texture arrays along with the last one.
+        """
+        self.scenes.remove(scene)
+        if self.drawing is scene:
+            self.drawing = None
+        if self.scenes:
+            return
+
+        for shader in (self.shader, self.plain_shader, self.picker_shader):
+            self.resources.release(PROGRAM, shader.id())
+        self.resources.release(TEXTURE, self.null_texture.id())
+        if self.texture_arrays is not None:
+            self.texture_arrays.release()
+        self.resources.flush()
+        self.shader = self.plain_shader = self.picker_shader = self.null_texture = self.texture_arrays = None
+        self.evicted_textures.clear()
+        self.pending_textures.clear()
+        self._assets.clear()
+
+    def tick(self) -> int:
+        """
+        Advances and returns the frame counter the scenes measure last_used in.
+        """
+        self._frame += 1
+        return self._frame
+
+    def find(self, key: Hashable) -> Optional[SharedAsset]:
+        """
+        Returns the asset loaded under the given key, counting the caller as another holder, or None.
+        """
+        asset = self._assets.get(key)
+        if asset is not None:
+            asset.holders += 1
+        return asset
+
+    def share(self, key: Hashable, value: Any) -> SharedAsset:
+        """
+        Adds an asset the caller has just loaded, held by the caller alone.
+        """
+        asset = SharedAsset(key, value)
+        self._assets[key] = asset
+        return asset
+
+    def forget(self, asset: SharedAsset) -> None:
+        """
+        Stops handing the asset out, for example after its file changed.
+        """
+        if self._assets.get(asset.key) is asset:
+            del self._assets[asset.key]
+
+    def release(self, asset: SharedAsset) -> bool:
+        """
+        Counts one holder less and returns True if that was the last, in which case the caller deletes the GL objects.
+        """
+        asset.holders -= 1
+        if asset.holders > 0:
+            return False
+        self.forget(asset)
+        return True
@@ -0,0 +1,295 @@
+from __future__ import annotations
+
+import ctypes
+from typing import List, Optional, Tuple
+
+import numpy
+from OpenGL.GL import glGetIntegerv, glBufferStorage, glBufferSubData, glGetBufferSubData
+from OpenGL.raw.GL.VERSION.GL_1_5 import glBindBuffer, glBufferData, glUnmapBuffer, GL_STREAM_DRAW, GL_STREAM_READ
+from OpenGL.raw.GL.VERSION.GL_2_1 import GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_PACK_BUFFER
+from OpenGL.raw.GL.VERSION.GL_3_0 import glMapBufferRange, glBindBufferRange, GL_MAP_WRITE_BIT, GL_MAP_READ_BIT
+from OpenGL.raw.GL.VERSION.GL_3_1 import GL_UNIFORM_BUFFER, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+from OpenGL.raw.GL.VERSION.GL_3_2 import glFenceSync, glClientWaitSync, glDeleteSync, GL_SYNC_GPU_COMMANDS_COMPLETE, \
+    GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_EXPIRED
+from OpenGL.raw.GL.VERSION.GL_4_4 import GL_MAP_PERSISTENT_BIT, GL_MAP_COHERENT_BIT
+from glm import mat4, vec4
+
+from pykotor.gl.resources import GLResources, BUFFER
+from pykotor.gl.shader import FRAME_BINDING, OBJECT_BINDING, INSTANCE_BINDING, MAX_INSTANCES
+
+FRAME_BLOCK_SIZE = 128
+OBJECT_BLOCK_SIZE = 96
+INSTANCE_BLOCK_SIZE = 64 * MAX_INSTANCES
+
+
+class RingBuffer:
+    """
+    A persistently mapped GPU buffer split into one fenced region per frame in flight, falling back to glBufferSubData
+    without ARB_buffer_storage.
+    """
+
+    def __init__(self, resources: GLResources, target: int, region_size: int, regions: int = 3):
+        self.resources: GLResources = resources
+        self.target: int = target
+        self.persistent: bool = bool(glBufferStorage)
+        self.data: numpy.ndarray = numpy.zeros(0, numpy.uint8)
+        self.floats: numpy.ndarray = self.data.view(numpy.float32)
+        self.ints: numpy.ndarray = self.data.view(numpy.int32)
+
+        self._id: int = 0
+        self._regions: int = regions
+        self._region_size: int = region_size
+        self._region: int = 0
+        self._cursor: int = 0
+        self._fences: List[Optional[int]] = [None] * regions
+        self._alignment: int = max(4, int(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT))) \
+            if target == GL_UNIFORM_BUFFER else 4
+
+        self._allocate()
+
+    def id(self) -> int:
+        return self._id
+
+    def _allocate(self) -> None:
+        size = self._region_size * self._regions
+
+        self._id = self.resources.buffer(size)
+        glBindBuffer(self.target, self._id)
+        if self.persistent:
+            flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT
+            glBufferStorage(self.target, size, None, flags)
+            address = glMapBufferRange(self.target, 0, size, flags)
+            self.data = numpy.frombuffer((ctypes.c_ubyte * size).from_address(address), numpy.uint8)
+        else:
+            glBufferData(self.target, size, None, GL_STREAM_DRAW)
+            self.data = numpy.zeros(size, numpy.uint8)
+        self.floats = self.data.view(numpy.float32)
+        self.ints = self.data.view(numpy.int32)
+        glBindBuffer(self.target, 0)
+
+    def _release(self) -> None:
+        for i in range(self._regions):
+            self._wait(i)
+        if self.persistent:
+            glBindBuffer(self.target, self._id)
+            glUnmapBuffer(self.target)
+            glBindBuffer(self.target, 0)
+        self.resources.release(BUFFER, self._id)
+
+    def release(self) -> None:
+        """
+        Waits for the GPU to finish with every region and deletes the buffer.
+        """
+        self._release()
+        self.data = numpy.zeros(0, numpy.uint8)
+        self.floats = self.data.view(numpy.float32)
+        self.ints = self.data.view(numpy.int32)
+
+    def _wait(self, region: int) -> None:
+        fence = self._fences[region]
+        if fence is None:
+            return
+        while glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED:
+            pass
+        glDeleteSync(fence)
+        self._fences[region] = None
+
+    def begin_frame(self) -> None:
+        self._region = (self._region + 1) % self._regions
+        self._wait(self._region)
+        self._cursor = 0
+
+    def end_frame(self) -> None:
+        self._fences[self._region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+
+    def allocate(self, size: int) -> int:
+        """
+        Reserves space in the current frame's region and returns its offset, growing the buffer if the region is full.
+        """
+        if self._cursor + size > self._region_size:
+            self._release()
+            self._region_size = max(self._region_size * 2, size * 4)
+            self._allocate()
+            self._cursor = 0
+            self._reallocated()
+
+        offset = self._region * self._region_size + self._cursor
+        self._cursor += (size + self._alignment - 1) // self._alignment * self._alignment
+        return offset
+
+    def _reallocated(self) -> None:
+        # Deleting the old buffer reset every binding that pointed into it.
+        ...
+
+    def flush(self, offset: int, size: int) -> None:
+        if not self.persistent:
+            glBindBuffer(self.target, self._id)
+            glBufferSubData(self.target, offset, size, self.data[offset:offset + size])
+            glBindBuffer(self.target, 0)
+
+
+class UniformStream(RingBuffer):
+    """
+    Streams the Frame, Object and Instances uniform blocks the shaders read through glBindBufferRange.
+    """
+
+    def __init__(self, resources: GLResources, region_size: int = 1 << 20):
+        super().__init__(resources, GL_UNIFORM_BUFFER, max(region_size, INSTANCE_BLOCK_SIZE))
+        self.color: vec4 = vec4(1.0, 1.0, 1.0, 1.0)
+        self.object_id: int = 0
+        self._camera: Optional[Tuple[mat4, mat4]] = None
+
+    def _reallocated(self) -> None:
+        if self._camera is not None:
+            self.bind_camera(*self._camera)
+
+    def bind_camera(self, view: mat4, projection: mat4) -> None:
+        self._camera = (view, projection)
+        offset = self.allocate(FRAME_BLOCK_SIZE)
+        index = offset // 4
+        self.floats[index:index + 16] = numpy.frombuffer(view.to_bytes(), numpy.float32)
+        self.floats[index + 16:index + 32] = numpy.frombuffer(projection.to_bytes(), numpy.float32)
+        self.flush(offset, FRAME_BLOCK_SIZE)
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, self._id, offset, FRAME_BLOCK_SIZE)
+        # Draws that are not instanced never read the Instances block, but a block must be backed by a large enough
+        # range whenever a program declaring it draws
+        glBindBufferRange(GL_UNIFORM_BUFFER, INSTANCE_BINDING, self._id, 0, INSTANCE_BLOCK_SIZE)
+
+    def bind_object(self, transform: mat4, layers: Tuple[int, int] = (-1, -1), instanced: bool = False) -> None:
+        offset = self.allocate(OBJECT_BLOCK_SIZE)
+        index = offset // 4
+        self.floats[index:index + 16] = numpy.frombuffer(transform.to_bytes(), numpy.float32)
+        self.floats[index + 16:index + 20] = numpy.frombuffer(self.color.to_bytes(), numpy.float32)
+        self.ints[index + 20:index + 22] = layers
+        self.ints[index + 22] = self.object_id
+        self.ints[index + 23] = int(instanced)
+        self.flush(offset, OBJECT_BLOCK_SIZE)
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, self._id, offset, OBJECT_BLOCK_SIZE)
+
+    def bind_instances(self, transforms: List[mat4], layers: Tuple[int, int] = (-1, -1)) -> None:
+        """
+        Binds the model matrices of an instanced draw, at most MAX_INSTANCES.
+        """
+        self.bind_object(mat4(), layers, True)
+        size = 64 * len(transforms)
+        offset = self.allocate(INSTANCE_BLOCK_SIZE)
+        index = offset // 4
+        self.floats[index:index + size // 4] = numpy.frombuffer(b"".join(transform.to_bytes()
+                                                                         for transform in transforms), numpy.float32)
+        self.flush(offset, size)
+        glBindBufferRange(GL_UNIFORM_BUFFER, INSTANCE_BINDING, self._id, offset, INSTANCE_BLOCK_SIZE)
+
+
+class PixelUploadRing(RingBuffer):
+    """
+    Stages texture data in a ring of pixel unpack buffers so the driver can upload it asynchronously.
+    """
+
+    def __init__(self, resources: GLResources, region_size: int = 8 << 20):
+        super().__init__(resources, GL_PIXEL_UNPACK_BUFFER, region_size)
+
+    def _reallocated(self) -> None:
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, self._id)
+
+    def stage(self, data: bytes) -> ctypes.c_void_p:
+        """
+        Copies the data into the current region and returns the pointer to pass to GL in its place; call unbind()
+        afterwards.
+        """
+        size = len(data)
+        offset = self.allocate(size)
+        self.data[offset:offset + size] = numpy.frombuffer(data, numpy.uint8)
+        self.flush(offset, size)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, self._id)
+        return ctypes.c_void_p(offset)
+
+    def unbind(self) -> None:
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0)
+
+
+class ReadbackBuffer:
+    """
+    A pixel pack buffer that glReadPixels writes into asynchronously for the CPU to read once ready() is true.
+    """
+
+    def __init__(self, resources: GLResources, size: int):
+        self.resources: GLResources = resources
+        self.persistent: bool = bool(glBufferStorage)
+        self.size: int = 0
+        self._id: int = 0
+        self._fence: Optional[int] = None
+        self._mapped: numpy.ndarray = numpy.zeros(0, numpy.uint8)
+        self.resize(size)
+
+    def resize(self, size: int) -> None:
+        if size == self.size:
+            return
+        if self._id:
+            self.release()
+
+        self.size = size
+        self._id = self.resources.buffer(size)
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, self._id)
+        if self.persistent:
+            flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, size, None, flags)
+            address = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags)
+            self._mapped = numpy.frombuffer((ctypes.c_ubyte * size).from_address(address), numpy.uint8)
+        else:
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, None, GL_STREAM_READ)
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0)
+
+    def release(self) -> None:
+        self.wait()
+        if self.persistent:
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, self._id)
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER)
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0)
+        self.resources.release(BUFFER, self._id)
+        self._id = 0
+        self.size = 0
+
+    def bind(self) -> None:
+        """
+        Binds the buffer so that the pointer argument of glReadPixels is taken as an offset into it.
+        """
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, self._id)
+
+    def unbind(self) -> None:
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0)
+
+    def fence(self) -> None:
+        if self._fence is not None:
+            glDeleteSync(self._fence)
+        self._fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+
+    def ready(self) -> bool:
+        if self._fence is None:
+            return True
+        if glClientWaitSync(self._fence, 0, 0) == GL_TIMEOUT_EXPIRED:
+            return False
+        glDeleteSync(self._fence)
+        self._fence = None
+        return True
+
+    def wait(self) -> None:
+        if self._fence is None:
+            return
+        while glClientWaitSync(self._fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED:
+            pass
+        glDeleteSync(self._fence)
+        self._fence = None
+
+    def read(self, offset: int, size: int) -> numpy.ndarray:
+        """
+        Returns the bytes in the given range, waiting for pending reads first.
+        """
+        self.wait()
+        if self.persistent:
+            return self._mapped[offset:offset + size]
+
+        data = numpy.empty(size, numpy.uint8)
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, self._id)
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, offset, size, data)
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0)
+        return data
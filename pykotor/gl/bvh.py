@@ -0,0 +1,136 @@
+from __future__ import annotations
+
+import math
+from typing import List, Optional, Tuple
+
+import numpy
+
+LEAF_SIZE = 16
+
+
+def intersect_triangles(origin: numpy.ndarray, direction: numpy.ndarray, v0: numpy.ndarray, e1: numpy.ndarray,
+                        e2: numpy.ndarray) -> numpy.ndarray:
+    """
+    Returns the ray parameter of the hit for each triangle given by its first vertex and two edges, inf where the ray
+    misses.
+    """
+    p = numpy.cross(direction, e2)
+    determinant = numpy.einsum("ij,ij->i", e1, p)
+    valid = numpy.abs(determinant) > 1e-12
+    inverse = 1.0 / numpy.where(valid, determinant, 1.0)
+
+    s = origin - v0
+    u = numpy.einsum("ij,ij->i", s, p) * inverse
+    q = numpy.cross(s, e1)
+    v = q @ direction * inverse
+    t = numpy.einsum("ij,ij->i", e2, q) * inverse
+
+    hit = valid & (u >= 0.0) & (v >= 0.0) & (u + v <= 1.0) & (t > 0.0)
+    return numpy.where(hit, t, numpy.inf)
+
+
+class TriangleBVH:
+    """
+    A bounding volume hierarchy over triangles, with the triangles of each leaf tested as one numpy batch.
+    """
+
+    def __init__(self, triangles: numpy.ndarray):
+        """
+        Builds the hierarchy over an array of shape (n, 3, 3): three vertices per triangle.
+        """
+        triangles = numpy.asarray(triangles, numpy.float64).reshape(-1, 3, 3)
+        self._bounds: List[Tuple[float, float, float, float, float, float]] = []
+        # Per node: (first child, second child) for inner nodes or (-1 - first triangle, triangle count) for leaves
+        self._links: List[Tuple[int, int]] = []
+
+        order = numpy.arange(len(triangles))
+        if len(triangles):
+            self._build(triangles.min(axis=1), triangles.max(axis=1), triangles.mean(axis=1), order, 0, len(order))
+
+        ordered = triangles[order]
+        # The original index of each reordered triangle, so hits can be reported by input index
+        self.order: numpy.ndarray = order
+        self._v0: numpy.ndarray = ordered[:, 0]
+        self._e1: numpy.ndarray = ordered[:, 1] - ordered[:, 0]
+        self._e2: numpy.ndarray = ordered[:, 2] - ordered[:, 0]
+
+    def __len__(self) -> int:
+        return len(self.order)
+
+    def _build(self, lows: numpy.ndarray, highs: numpy.ndarray, centers: numpy.ndarray, order: numpy.ndarray,
+               start: int, end: int) -> int:
+        index = len(self._bounds)
+        members = order[start:end]
+        low, high = lows[members].min(axis=0), highs[members].max(axis=0)
+        self._bounds.append((*low.tolist(), *high.tolist()))
+        self._links.append((0, 0))
+
+        if end - start <= LEAF_SIZE:
+            self._links[index] = (-1 - start, end - start)
+            return index
+
+        spread = centers[members].max(axis=0) - centers[members].min(axis=0)
+        axis = int(spread.argmax())
+        middle = (end - start) // 2
+        order[start:end] = members[numpy.argpartition(centers[members, axis], middle)]
+
+        first = self._build(lows, highs, centers, order, start, start + middle)
+        second = self._build(lows, highs, centers, order, start + middle, end)
+        self._links[index] = (first, second)
+        return index
+
+    def intersect(self, origin: Tuple[float, float, float], direction: Tuple[float, float, float],
+                  max_distance: float = math.inf) -> Optional[Tuple[float, int]]:
+        """
+        Returns (ray parameter, input triangle index) of the nearest triangle hit by the ray, or None.
+        """
+        if not self._bounds:
+            return None
+
+        inverse = tuple(1.0 / d if d != 0.0 else math.inf for d in direction)
+        origin_array = numpy.array(origin, numpy.float64)
+        direction_array = numpy.array(direction, numpy.float64)
+
+        best, best_index = max_distance, -1
+        stack = [(self._enter(0, origin, inverse, best), 0)]
+        while stack:
+            distance, node = stack.pop()
+            if distance is None or distance > best:
+                continue
+
+            first, second = self._links[node]
+            if first < 0:
+                start = -1 - first
+                end = start + second
+                distances = intersect_triangles(origin_array, direction_array, self._v0[start:end],
+                                                self._e1[start:end], self._e2[start:end])
+                nearest = int(distances.argmin())
+                if distances[nearest] < best:
+                    best, best_index = float(distances[nearest]), start + nearest
+                continue
+
+            # The nearer child goes on top of the stack so it is searched first and tightens best for the other
+            entries = [(self._enter(child, origin, inverse, best), child) for child in (first, second)]
+            entries = [entry for entry in entries if entry[0] is not None]
+            entries.sort(key=lambda entry: -entry[0])
+            stack.extend(entries)
+
+        return (best, int(self.order[best_index])) if best_index >= 0 else None
+
+    def _enter(self, node: int, origin: Tuple[float, float, float], inverse: Tuple[float, float, float],
+               max_distance: float) -> Optional[float]:
+        bounds = self._bounds[node]
+        near, far = 0.0, max_distance
+        for axis in range(3):
+            o, inv, lo, hi = origin[axis], inverse[axis], bounds[axis], bounds[axis + 3]
+            if inv == math.inf:
+                if o < lo or o > hi:
+                    return None
+                continue
+            t0, t1 = (lo - o) * inv, (hi - o) * inv
+            if t0 > t1:
+                t0, t1 = t1, t0
+            near, far = max(near, t0), min(far, t1)
+            if near > far:
+                return None
+        return near
@@ -0,0 +1,116 @@
+from __future__ import annotations
+
+import hashlib
+import json
+import math
+import time
+from typing import Any, Dict, List, Optional
+
+import numpy
+from glm import vec3
+from OpenGL.raw.GL.VERSION.GL_1_0 import glFinish
+
+from pykotor.gl.stats import RenderStats
+
+from typing import TYPE_CHECKING
+if TYPE_CHECKING:
+    from pykotor.gl.scene import Scene, Camera
+
+FIELDS = ["x", "y", "z", "yaw", "pitch", "distance", "fov"]
+PERCENTILES = [50, 90, 95, 99]
+
+
+class CameraPath:
+    """
+    A camera state per frame, recorded with record(), played back with replay() and saved as JSON.
+    """
+
+    def __init__(self, frames: Optional[List[List[float]]] = None):
+        self.frames: List[List[float]] = frames if frames is not None else []
+
+    def __len__(self) -> int:
+        return len(self.frames)
+
+    def record(self, camera: Camera) -> None:
+        self.frames.append([float(getattr(camera, field)) for field in FIELDS])
+
+    def apply(self, camera: Camera, frame: int) -> None:
+        for field, value in zip(FIELDS, self.frames[frame]):
+            if not math.isnan(value):
+                setattr(camera, field, value)
+
+    @classmethod
+    def orbit(cls, center: vec3, radius: float, frames: int, *, height: float = 2.0, fov: float = 90.0) -> CameraPath:
+        """
+        Returns a path that circles around center once, looking outwards.
+        """
+        path = cls()
+        for i in range(frames):
+            angle = i / frames * math.tau
+            path.frames.append([center.x + math.cos(angle) * radius, center.y + math.sin(angle) * radius,
+                                center.z + height, angle + math.pi, math.pi / 2, 0.0, fov])
+        return path
+
+    def save(self, path: str) -> None:
+        with open(path, "w") as file:
+            json.dump({"fields": FIELDS, "frames": self.frames}, file)
+
+    @classmethod
+    def load(cls, path: str) -> CameraPath:
+        with open(path) as file:
+            data = json.load(file)
+        # Paths written with other or reordered fields still load; missing fields keep the camera's current value
+        indices = [data["fields"].index(field) if field in data["fields"] else None for field in FIELDS]
+        return cls([[frame[index] if index is not None else math.nan for index in indices] for frame in data["frames"]])
+
+
+def replay(scene: Scene, path: CameraPath, *, keyframe_interval: int = 0, warmup: bool = True) -> Dict[str, Any]:
+    """
+    Renders every frame of the path and returns frame time percentiles, per-pass statistics and image checksums every
+    keyframe_interval frames.
+    """
+    if warmup:
+        for frame in range(len(path)):
+            path.apply(scene.camera, frame)
+            scene.render()
+        scene.waitForTextures()
+
+    scene.stats.release()
+    scene.stats = RenderStats(scene.assets.resources, scene, max(1, len(path)))
+
+    times = []
+    checksums = []
+    for frame in range(len(path)):
+        path.apply(scene.camera, frame)
+        start = time.perf_counter()
+        scene.render()
+        # Without this the time would only cover issuing the frame, not drawing it
+        glFinish()
+        times.append(time.perf_counter() - start)
+
+        if keyframe_interval and frame % keyframe_interval == 0 and scene.framebuffer is not None:
+            image = numpy.ascontiguousarray(scene.framebuffer.read_color())
+            checksums.append({"frame": frame, "sha256": hashlib.sha256(image.tobytes()).hexdigest()})
+
+    milliseconds = numpy.array(times) * 1000
+    return {
+        "frames": len(path),
+        "frame_ms": {
+            "mean": float(milliseconds.mean()) if len(milliseconds) else 0.0,
+            "max": float(milliseconds.max()) if len(milliseconds) else 0.0,
+            **{"p{}".format(p): float(numpy.percentile(milliseconds, p)) if len(milliseconds) else 0.0
+               for p in PERCENTILES},
+        },
+        "stats": scene.stats.summary(),
+        "checksums": checksums,
+    }
+
+
+def compare_checksums(results: Dict[str, Any], reference: Dict[str, Any]) -> List[int]:
+    """
+    Returns the keyframes whose image differs between two replay() results of the same path.
+    """
+    expected = {entry["frame"]: entry["sha256"] for entry in reference.get("checksums", [])}
+    return [entry["frame"] for entry in results.get("checksums", [])
+            if entry["frame"] in expected and expected[entry["frame"]] != entry["sha256"]]
+
@@ -0,0 +1,94 @@
+from __future__ import annotations
+
+from typing import Any, Dict, Hashable, List, Optional, Tuple
+
+from glm import mat4
+
+from pykotor.extract.installation import Installation
+from pykotor.resource.generics.utc import UTC
+from pykotor.resource.generics.uti import UTI, read_uti
+from pykotor.resource.type import ResourceType
+
+
+def assembly_key(utc: UTC, installation: Optional[InstallationCache] = None) -> Tuple:
+    """
+    Returns what the models and textures of a creature are derived from: its appearance, variations and the look of
+    every equipped item.
+    """
+    equipment = []
+    for slot, item in utc.equipment.items():
+        uti = installation.uti(str(item.resref)) if installation is not None else None
+        look = (uti.base_item, uti.model_variation, uti.body_variation, uti.texture_variation) if uti is not None \
+            else str(item.resref).lower()
+        equipment.append((slot.value, look))
+    return utc.appearance_id, utc.body_variation, utc.texture_variation, tuple(sorted(equipment))
+
+
+class CreatureAssembly:
+    """
+    The models a creature is drawn with and the transforms of their hooks, shared by creatures with the same
+    assembly_key().
+    """
+
+    def __init__(self, body_model: str, body_texture: Optional[str]):
+        self.body_model: str = body_model
+        self.body_texture: Optional[str] = body_texture
+        self.head: Optional[Tuple[str, Optional[str], mat4]] = None
+        self.hands: List[Tuple[str, mat4]] = []
+        self.mask: Optional[Tuple[str, mat4]] = None
+        # Whether the mask hangs from the head rather than from the body
+        self.mask_on_head: bool = False
+
+
+class InstallationCache:
+    """
+    Stands in for an Installation, remembering the resources and item blueprints it looked up and passing everything
+    else through.
+    """
+
+    def __init__(self, installation: Installation, types: Tuple[ResourceType, ...] = (ResourceType.UTI,)):
+        self.installation: Installation = installation
+        self._types: Tuple[ResourceType, ...] = types
+        self._resources: Dict[Hashable, Any] = {}
+        self._utis: Dict[str, Optional[UTI]] = {}
+
+    def resource(self, resname: str, restype: ResourceType, order: Optional[List[Any]] = None, **kwargs) -> Any:
+        if restype not in self._types:
+            return self.installation.resource(resname, restype, order, **kwargs)
+
+        # Capsules and folders to search change the result, so they are part of the key
+        key = (str(resname).lower(), restype, _hashable(order),
+               tuple(sorted((name, _hashable(value)) for name, value in kwargs.items())))
+        if key not in self._resources:
+            self._resources[key] = self.installation.resource(resname, restype, order, **kwargs)
+        return self._resources[key]
+
+    def uti(self, resname: str) -> Optional[UTI]:
+        """
+        Returns the parsed item blueprint with the given resref, or None if there is none or it cannot be read.
+        """
+        resname = resname.lower()
+        if resname not in self._utis:
+            result = self.resource(resname, ResourceType.UTI)
+            try:
+                self._utis[resname] = read_uti(result.data) if result else None
+            except (ValueError, IOError):
+                self._utis[resname] = None
+        return self._utis[resname]
+
+    def forget(self, resname: str, restype: ResourceType) -> None:
+        for key in [key for key in self._resources if key[0] == resname.lower() and key[1] == restype]:
+            del self._resources[key]
+        if restype == ResourceType.UTI:
+            self._utis.pop(resname.lower(), None)
+
+    def clear(self) -> None:
+        self._resources.clear()
+        self._utis.clear()
+
+    def __getattr__(self, name: str) -> Any:
+        return getattr(self.installation, name)
+
+
+def _hashable(value: Any) -> Hashable:
+    return tuple(_hashable(item) for item in value) if isinstance(value, (list, tuple)) else value
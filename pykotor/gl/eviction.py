@@ -0,0 +1,36 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING, Callable, Dict, Iterable
+
+if TYPE_CHECKING:
+    from pykotor.gl.models.mdl import Model
+    from pykotor.gl.shader import Texture
+
+
+def vram_usage(textures: Iterable[Texture], models: Iterable[Model]) -> int:
+    """
+    Returns the bytes the given textures and models hold on the GPU.
+    """
+    return sum(texture.size for texture in textures) + sum(model.size() for model in models)
+
+
+def evict(usage: int, budget: int, frame: int, textures: Dict[str, Texture], models: Dict[str, Model],
+          free_texture: Callable[[str], int], free_model: Callable[[str], int]) -> int:
+    """
+    Frees the least recently drawn textures and models not drawn this frame until usage fits in budget, and returns the
+    usage left.
+    """
+    if usage <= budget:
+        return usage
+
+    entries = [(texture.last_used, 0, name) for name, texture in textures.items()
+               if texture.size > 0 and texture.last_used < frame]
+    entries += [(model.last_used, 1, name) for name, model in models.items()
+                if model.size() > 0 and model.last_used < frame]
+    entries.sort()
+
+    for last_used, kind, name in entries:
+        if usage <= budget:
+            break
+        usage -= free_texture(name) if kind == 0 else free_model(name)
+    return usage
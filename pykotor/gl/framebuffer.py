@@ -0,0 +1,119 @@
+from __future__ import annotations
+
+import ctypes
+from typing import Any, Tuple
+
+import numpy
+from OpenGL.GL import glTexImage2D, glGetIntegerv
+from OpenGL.raw.GL.VERSION.GL_1_0 import GL_TEXTURE_2D, glTexParameteri, GL_TEXTURE_MIN_FILTER, \
+    GL_TEXTURE_MAG_FILTER, GL_NEAREST, GL_RGBA, GL_UNSIGNED_BYTE, GL_DEPTH_COMPONENT, GL_FLOAT, glViewport, \
+    glReadPixels
+from OpenGL.raw.GL.VERSION.GL_1_1 import glBindTexture, GL_RGBA8
+from OpenGL.raw.GL.VERSION.GL_3_0 import glBindFramebuffer, glFramebufferTexture2D, glCheckFramebufferStatus, \
+    GL_FRAMEBUFFER, GL_READ_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT, \
+    GL_FRAMEBUFFER_COMPLETE, GL_DEPTH_COMPONENT32F, GL_READ_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER_BINDING
+
+from pykotor.gl.buffer import ReadbackBuffer
+from pykotor.gl.resources import GLResources, FRAMEBUFFER, TEXTURE
+
+
+def framebuffer_bindings() -> Tuple[int, int]:
+    """
+    Returns the framebuffers bound for drawing and for reading.
+    """
+    return int(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING)), int(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING))
+
+
+class Framebuffer:
+    """
+    An offscreen render target with an RGBA8 color texture and a float depth texture, read back through a mapped pixel
+    pack buffer.
+    """
+
+    def __init__(self, width: int, height: int, resources: GLResources, owner: Any):
+        self.width: int = 0
+        self.height: int = 0
+        self.resources: GLResources = resources
+        self._owner: Any = owner
+        self._fbo: int = resources.framebuffer(owner)
+        self._color: int = resources.texture()
+        self._depth: int = resources.texture()
+        self._readback: ReadbackBuffer = ReadbackBuffer(resources, width * height * 8)
+        self.resize(width, height)
+
+    def resize(self, width: int, height: int) -> None:
+        if (width, height) == (self.width, self.height):
+            return
+        self.width, self.height = width, height
+
+        glBindTexture(GL_TEXTURE_2D, self._color)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, None)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
+
+        glBindTexture(GL_TEXTURE_2D, self._depth)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, None)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
+        glBindTexture(GL_TEXTURE_2D, 0)
+        self.resources.resize(TEXTURE, self._color, width * height * 4)
+        self.resources.resize(TEXTURE, self._depth, width * height * 4)
+
+        draw, read = framebuffer_bindings()
+        glBindFramebuffer(GL_FRAMEBUFFER, self._fbo)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, self._color, 0)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, self._depth, 0)
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+        if status != GL_FRAMEBUFFER_COMPLETE:
+            raise RuntimeError("Framebuffer is incomplete (status 0x{:X}).".format(status))
+
+        self._readback.resize(width * height * 8)
+
+    def id(self) -> int:
+        return self._fbo
+
+    def color_texture(self) -> int:
+        return self._color
+
+    def depth_texture(self) -> int:
+        return self._depth
+
+    def bind(self) -> None:
+        glBindFramebuffer(GL_FRAMEBUFFER, self._fbo)
+        glViewport(0, 0, self.width, self.height)
+
+    def unbind(self) -> None:
+        glBindFramebuffer(GL_FRAMEBUFFER, 0)
+
+    def read_color(self) -> numpy.ndarray:
+        """
+        Returns the color attachment as an array of shape (height, width, 4), top row first, valid until the next read.
+        """
+        size = self.width * self.height * 4
+        self._read_pixels(GL_RGBA, GL_UNSIGNED_BYTE, 0)
+        return self._readback.read(0, size).reshape(self.height, self.width, 4)[::-1]
+
+    def read_depth(self) -> numpy.ndarray:
+        """
+        Returns the depth attachment as an array of shape (height, width), top row first, valid until the next read.
+        """
+        offset, size = self.width * self.height * 4, self.width * self.height * 4
+        self._read_pixels(GL_DEPTH_COMPONENT, GL_FLOAT, offset)
+        return self._readback.read(offset, size).view(numpy.float32).reshape(self.height, self.width)[::-1]
+
+    def _read_pixels(self, pixel_format: int, pixel_type: int, offset: int) -> None:
+        _, read = framebuffer_bindings()
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, self._fbo)
+        self._readback.bind()
+        glReadPixels(0, 0, self.width, self.height, pixel_format, pixel_type, ctypes.c_void_p(offset))
+        self._readback.unbind()
+        self._readback.fence()
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+
+    def release(self) -> None:
+        self._readback.release()
+        self.resources.release(FRAMEBUFFER, self._fbo, self._owner)
+        self.resources.release(TEXTURE, self._color)
+        self.resources.release(TEXTURE, self._depth)
@@ -0,0 +1,150 @@
+"""
+Rendering without a window. Call configure() before anything imports PyOpenGL to select the EGL platform, unless
+PYOPENGL_PLATFORM is already set; set PYOPENGL_PLATFORM=osmesa to use OSMesa instead. Both work with Mesa's llvmpipe
+software rasterizer.
+
+    headless.configure()
+    context = HeadlessContext(1280, 720)
+    scene = context.scene(installation=installation, module=module)
+    scene.render()
+    image = scene.framebuffer.read_color()
+"""
+from __future__ import annotations
+
+import ctypes
+import os
+import sys
+from typing import List, Optional, Tuple
+
+from typing import TYPE_CHECKING
+if TYPE_CHECKING:
+    from pykotor.gl.scene import Scene
+
+# Context versions to try, newest first; the scene needs at least 3.3 and uses 4.x features where available
+CONTEXT_VERSIONS: List[Tuple[int, int]] = [(4, 6), (4, 5), (4, 3), (4, 2), (3, 3)]
+
+
+def configure(software: bool = True) -> None:
+    """
+    Selects the EGL platform and optionally Mesa's software rasterizer; must be called before anything imports OpenGL.
+    """
+    if "OpenGL" in sys.modules and os.environ.get("PYOPENGL_PLATFORM") is None:
+        raise RuntimeError("OpenGL was imported before headless.configure() was called.")
+    os.environ.setdefault("PYOPENGL_PLATFORM", "egl")
+    if software:
+        os.environ.setdefault("LIBGL_ALWAYS_SOFTWARE", "1")
+
+
+class HeadlessContext:
+    """
+    An OpenGL context that is not attached to any window, created through EGL or OSMesa.
+    """
+
+    def __init__(self, width: int = 1280, height: int = 720, backend: Optional[str] = None):
+        self.width: int = width
+        self.height: int = height
+        self.backend: str = backend if backend is not None else os.environ.get("PYOPENGL_PLATFORM", "")
+        if self.backend != os.environ.get("PYOPENGL_PLATFORM"):
+            raise RuntimeError("PyOpenGL was loaded for the '{}' platform; set PYOPENGL_PLATFORM={} before OpenGL is "
+                               "imported to use that backend.".format(os.environ.get("PYOPENGL_PLATFORM"), backend))
+
+        if self.backend == "egl":
+            self._create_egl()
+        elif self.backend == "osmesa":
+            self._create_osmesa()
+        else:
+            raise RuntimeError("Headless rendering needs PYOPENGL_PLATFORM set to 'egl' or 'osmesa'.")
+
+    def _create_egl(self) -> None:
+        from OpenGL import EGL
+
+        self._display = EGL.eglGetDisplay(EGL.EGL_DEFAULT_DISPLAY)
+        major, minor = EGL.EGLint(), EGL.EGLint()
+        if not EGL.eglInitialize(self._display, ctypes.pointer(major), ctypes.pointer(minor)):
+            raise RuntimeError("Could not initialize the EGL display.")
+
+        config_attributes = [EGL.EGL_SURFACE_TYPE, EGL.EGL_PBUFFER_BIT, EGL.EGL_RED_SIZE, 8, EGL.EGL_GREEN_SIZE, 8,
+                             EGL.EGL_BLUE_SIZE, 8, EGL.EGL_ALPHA_SIZE, 8, EGL.EGL_DEPTH_SIZE, 24,
+                             EGL.EGL_RENDERABLE_TYPE, EGL.EGL_OPENGL_BIT, EGL.EGL_NONE]
+        config = EGL.EGLConfig()
+        count = EGL.EGLint()
+        EGL.eglChooseConfig(self._display, (EGL.EGLint * len(config_attributes))(*config_attributes),
+                            ctypes.pointer(config), 1, ctypes.pointer(count))
+        if count.value == 0:
+            raise RuntimeError("No EGL config supports desktop OpenGL rendering.")
+
+        # Scenes render into the framebuffer scene() gives them, so the surface only has to exist
+        surface_attributes = [EGL.EGL_WIDTH, 1, EGL.EGL_HEIGHT, 1, EGL.EGL_NONE]
+        self._surface = EGL.eglCreatePbufferSurface(self._display, config, (EGL.EGLint * len(surface_attributes))(
+            *surface_attributes))
+        EGL.eglBindAPI(EGL.EGL_OPENGL_API)
+
+        self._context = None
+        for major_version, minor_version in CONTEXT_VERSIONS:
+            context_attributes = [EGL.EGL_CONTEXT_MAJOR_VERSION, major_version,
+                                  EGL.EGL_CONTEXT_MINOR_VERSION, minor_version,
+                                  EGL.EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                  EGL.EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT, EGL.EGL_NONE]
+            self._context = EGL.eglCreateContext(self._display, config, EGL.EGL_NO_CONTEXT,
+                                                 (EGL.EGLint * len(context_attributes))(*context_attributes))
+            if self._context:
+                break
+        if not self._context:
+            raise RuntimeError("Could not create an OpenGL 3.3 or newer context through EGL.")
+
+        self.make_current()
+
+    def _create_osmesa(self) -> None:
+        from OpenGL import osmesa
+        from OpenGL.raw.GL.VERSION.GL_1_0 import GL_UNSIGNED_BYTE
+        from OpenGL.arrays import GLubyteArray
+
+        self._context = None
+        for major_version, minor_version in CONTEXT_VERSIONS:
+            attributes = [osmesa.OSMESA_FORMAT, osmesa.OSMESA_RGBA, osmesa.OSMESA_DEPTH_BITS, 24,
+                          osmesa.OSMESA_PROFILE, osmesa.OSMESA_COMPAT_PROFILE,
+                          osmesa.OSMESA_CONTEXT_MAJOR_VERSION, major_version,
+                          osmesa.OSMESA_CONTEXT_MINOR_VERSION, minor_version, 0]
+            self._context = osmesa.OSMesaCreateContextAttribs(attributes, None)
+            if self._context:
+                break
+        if not self._context:
+            raise RuntimeError("Could not create an OpenGL 3.3 or newer context through OSMesa.")
+
+        # Like the EGL surface, the OSMesa buffer only has to exist
+        self._buffer = GLubyteArray.zeros((1, 1, 4))
+        self._buffer_type = GL_UNSIGNED_BYTE
+        self.make_current()
+
+    def make_current(self) -> None:
+        if self.backend == "egl":
+            from OpenGL import EGL
+            EGL.eglMakeCurrent(self._display, self._surface, self._surface, self._context)
+        else:
+            from OpenGL import osmesa
+            osmesa.OSMesaMakeCurrent(self._context, self._buffer, self._buffer_type, 1, 1)
+
+    def release(self) -> None:
+        if self.backend == "egl":
+            from OpenGL import EGL
+            EGL.eglMakeCurrent(self._display, EGL.EGL_NO_SURFACE, EGL.EGL_NO_SURFACE, EGL.EGL_NO_CONTEXT)
+            EGL.eglDestroySurface(self._display, self._surface)
+            EGL.eglDestroyContext(self._display, self._context)
+            EGL.eglTerminate(self._display)
+        else:
+            from OpenGL import osmesa
+            osmesa.OSMesaDestroyContext(self._context)
+
+    def scene(self, **kwargs) -> Scene:
+        """
+        Creates a scene in this context that renders into a framebuffer of the context's size.
+        """
+        from pykotor.gl.framebuffer import Framebuffer
+        from pykotor.gl.scene import Scene
+
+        self.make_current()
+        scene = Scene(**kwargs)
+        scene.framebuffer = Framebuffer(self.width, self.height, scene.assets.resources, scene)
+        scene.camera.width = self.width
+        scene.camera.height = self.height
+        return scene
@@ -0,0 +1,104 @@
+from __future__ import annotations
+
+import hashlib
+import os
+import struct
+import tempfile
+from typing import Optional
+
+from glm import quat, vec3
+from pykotor.common.stream import BinaryReader
+
+from pykotor.gl.models.read_mdl import StitchedModelData, parse_stitched_model
+
+# Changes whenever parse_stitched_model() or the layout of StitchedModelData does, so older entries are read as misses
+CACHE_MAGIC = b"MDC1"
+
+
+class ModelCache:
+    """
+    Keeps parsed models in a directory under a hash of their MDL and MDX data, so each is only parsed once across runs.
+    """
+
+    def __init__(self, cache_dir: Optional[str] = None):
+        self.cache_dir: str = cache_dir if cache_dir is not None else \
+            os.path.join(os.path.expanduser("~"), ".cache", "pykotor", "models")
+
+    def parse(self, mdl_data: bytes, mdx_data: bytes) -> StitchedModelData:
+        """
+        Returns the parsed model, read from the cache if it has been parsed before.
+        """
+        digest = hashlib.sha1(struct.pack("<I", len(mdl_data)))
+        digest.update(mdl_data)
+        digest.update(mdx_data)
+        path = os.path.join(self.cache_dir, digest.hexdigest() + ".mdc")
+
+        cached = self._read(path)
+        if cached is not None:
+            return cached
+
+        data = parse_stitched_model(BinaryReader.from_bytes(mdl_data, 12), BinaryReader.from_bytes(mdx_data))
+        self._write(path, data)
+        return data
+
+    @staticmethod
+    def _read(path: str) -> Optional[StitchedModelData]:
+        try:
+            with open(path, "rb") as file:
+                data = file.read()
+        except OSError:
+            return None
+
+        if data[:4] != CACHE_MAGIC:
+            return None
+        offset = 4
+
+        def chunk() -> bytes:
+            nonlocal offset
+            size, = struct.unpack_from("<I", data, offset)
+            offset += 4 + size
+            if offset > len(data):
+                raise ValueError("truncated entry")
+            return data[offset - size:offset]
+
+        model = StitchedModelData()
+        try:
+            hooks, meshes = struct.unpack_from("<II", data, offset)
+            offset += 8
+            for _ in range(hooks):
+                name = chunk().decode()
+                x, y, z, w, qx, qy, qz = struct.unpack_from("<7f", data, offset)
+                offset += 28
+                model.hooks.append((name, vec3(x, y, z), quat(w, qx, qy, qz)))
+            for _ in range(meshes):
+                texture, lightmap = chunk().decode(), chunk().decode()
+                vertex_data, element_data = chunk(), chunk()
+                data_bitflags, = struct.unpack_from("<I", data, offset)
+                offset += 4
+                model.meshes.append((texture, lightmap, vertex_data, element_data, data_bitflags))
+        except (struct.error, ValueError):
+            return None
+        return model
+
+    def _write(self, path: str, model: StitchedModelData) -> None:
+        def chunk(value: bytes) -> bytes:
+            return struct.pack("<I", len(value)) + value
+
+        # Written to a temporary file first, so other workers and processes never read a partial entry
+        try:
+            os.makedirs(self.cache_dir, exist_ok=True)
+            fd, temp_path = tempfile.mkstemp(dir=self.cache_dir, suffix=".tmp")
+            with os.fdopen(fd, "wb") as file:
+                file.write(CACHE_MAGIC)
+                file.write(struct.pack("<II", len(model.hooks), len(model.meshes)))
+                for name, position, rotation in model.hooks:
+                    file.write(chunk(name.encode()))
+                    file.write(struct.pack("<7f", position.x, position.y, position.z,
+                                           rotation.w, rotation.x, rotation.y, rotation.z))
+                for texture, lightmap, vertex_data, element_data, data_bitflags in model.meshes:
+                    file.write(chunk(texture.encode()) + chunk(lightmap.encode()))
+                    file.write(chunk(bytes(vertex_data)) + chunk(bytes(element_data)))
+                    file.write(struct.pack("<I", data_bitflags))
+            os.replace(temp_path, path)
+        except OSError:
+            pass
@@ -5,25 +5,27 @@ import math
 import struct
 from _testbuffer import ndarray
 from copy import copy
-from typing import Optional, List, Tuple
+from typing import Dict, Optional, List, Set, Tuple
 
 import glm
 import numpy
-from OpenGL.GL import glVertexAttribPointer, glGenVertexArrays, glGenBuffers
+from OpenGL.GL import glVertexAttribPointer
 from OpenGL.GL.shaders import GL_FALSE
 from OpenGL.raw.GL.ARB.tessellation_shader import GL_TRIANGLES
 from OpenGL.raw.GL.ARB.vertex_shader import GL_FLOAT
 from OpenGL.raw.GL.VERSION.GL_1_0 import GL_UNSIGNED_SHORT
 from OpenGL.raw.GL.VERSION.GL_1_1 import glDrawElements
-from OpenGL.raw.GL.VERSION.GL_1_3 import glActiveTexture, GL_TEXTURE0, GL_TEXTURE1
 from OpenGL.raw.GL.VERSION.GL_1_5 import GL_ARRAY_BUFFER, glBindBuffer, glBufferData, GL_ELEMENT_ARRAY_BUFFER, \
     GL_STATIC_DRAW
 from OpenGL.raw.GL.VERSION.GL_2_0 import glEnableVertexAttribArray
 from OpenGL.raw.GL.VERSION.GL_3_0 import glBindVertexArray
+from OpenGL.raw.GL.VERSION.GL_3_1 import glDrawElementsInstanced
 from glm import mat4, vec3, quat, vec4
 from pykotor.common.geometry import Vector3
 
-from pykotor.gl.shader import Shader
+from pykotor.gl.bvh import TriangleBVH
+from pykotor.gl.resources import GLResources, BUFFER, VERTEX_ARRAY
+from pykotor.gl.shader import Shader, Texture, DIFFUSE_UNIT, LIGHTMAP_UNIT, MAX_INSTANCES
 from typing import TYPE_CHECKING
 if TYPE_CHECKING:
     from pykotor.gl.scene import Scene
@@ -33,10 +35,86 @@ class Model:
     def __init__(self, scene: Scene, root: Node):
         self._scene: Scene = scene
         self.root: Node = root
-
-    def draw(self, shader: Shader, transform: mat4, *, override_texture: Optional[str] = None):
+        # Frame the model was last drawn in, used to pick models to evict
+        self.last_used: int = 0
+        self._size: Optional[int] = None
+        self._bvh: Optional[TriangleBVH] = None
+        self._bvh_nodes: List[Node] = []
+        self._bvh_node_index: Optional[numpy.ndarray] = None
+
+    def size(self) -> int:
+        """
+        Returns the number of bytes of vertex and element data the model's meshes hold on the GPU.
+        """
+        if self._size is None:
+            self._size = sum(node.mesh.size for node in self.all() if node.mesh)
+        return self._size
+
+    def detach(self, scene: Scene) -> None:
+        """
+        Deletes the vertex arrays the given scene draws the meshes with.
+        """
+        for node in self.all():
+            if node.mesh:
+                node.mesh.detach(scene)
+
+    def release(self) -> None:
+        """
+        Deletes the GL objects of every mesh.
+        """
+        for node in self.all():
+            if node.mesh:
+                node.mesh.release()
+
+    def textures(self) -> Set[str]:
+        """
+        Returns the names of the textures and lightmaps the meshes are drawn with.
+        """
+        names = set()
+        for node in self.all():
+            if node.mesh:
+                names.update(name for name in (node.mesh.texture, node.mesh.lightmap) if name != "NULL")
+        return names
+
+    def draw(self, shader: Shader, transform: mat4, *, override_texture: Optional[Texture] = None):
         self.root.draw(shader, transform, override_texture)
 
+    def gather(self, transform: mat4, draws: List[Tuple[Mesh, mat4, Optional[Texture]]], *,
+               override_texture: Optional[Texture] = None) -> None:
+        """
+        Appends (mesh, transform, override texture) for every mesh that draw() would draw.
+        """
+        self.root.gather(transform, draws, override_texture)
+
+    def raycast(self, origin: vec3, direction: vec3, max_distance: float = math.inf) -> Optional[Tuple[float, Node]]:
+        """
+        Returns (ray parameter, node) of the nearest triangle hit by the ray in model space, or None.
+        """
+        if self._bvh is None:
+            self._build_bvh()
+        hit = self._bvh.intersect((origin.x, origin.y, origin.z), (direction.x, direction.y, direction.z),
+                                  max_distance)
+        if hit is None:
+            return None
+        distance, triangle = hit
+        return distance, self._bvh_nodes[self._bvh_node_index[triangle]]
+
+    def _build_bvh(self) -> None:
+        triangles, node_index = [], []
+        search = [(self.root, mat4())]
+        while search:
+            node, transform = search.pop()
+            transform = transform * node._transform
+            if node.mesh and node.render:
+                mesh_triangles = node.mesh.triangles(transform)
+                triangles.append(mesh_triangles)
+                node_index.append(numpy.full(len(mesh_triangles), len(self._bvh_nodes), numpy.int32))
+                self._bvh_nodes.append(node)
+            search.extend((child, transform) for child in node.children)
+
+        self._bvh = TriangleBVH(numpy.concatenate(triangles) if triangles else numpy.zeros((0, 3, 3)))
+        self._bvh_node_index = numpy.concatenate(node_index) if node_index else numpy.zeros(0, numpy.int32)
+
     def find(self, name: str) -> Optional[Node]:
         nodes = [self.root]
         while nodes:
@@ -167,7 +245,7 @@ class Node:
         self._rotation = quat(vec3(pitch, yaw, roll))
         self._recalc_transform()
 
-    def draw(self, shader: Shader, transform: mat4, override_texture: Optional[str] = None):
+    def draw(self, shader: Shader, transform: mat4, override_texture: Optional[Texture] = None):
         transform = transform * self._transform
 
         if self.mesh and self.render:
@@ -176,6 +254,16 @@ class Node:
         for child in self.children:
             child.draw(shader, transform, override_texture=override_texture)
 
+    def gather(self, transform: mat4, draws: List[Tuple[Mesh, mat4, Optional[Texture]]],
+               override_texture: Optional[Texture] = None) -> None:
+        transform = transform * self._transform
+
+        if self.mesh and self.render:
+            draws.append((self.mesh, transform, override_texture))
+
+        for child in self.children:
+            child.gather(transform, draws, override_texture)
+
 
 class Mesh:
     def __init__(self, scene, node, texture, lightmap, vertex_data, element_data, block_size, data_bitflags,
@@ -185,51 +273,145 @@ class Mesh:
 
         self.texture: str = "NULL"
         self.lightmap: str = "NULL"
+        # Diffuse and lightmap handles per scene drawing the mesh; handles stay valid when a scene reloads a texture,
+        # so each scene only looks them up once
+        self._textures: Dict[Scene, Tuple[Texture, Texture]] = {}
 
         self.vertex_data = vertex_data
+        self.element_data = element_data
         self.mdx_size = block_size
         self.mdx_vertex = vertex_offset
+        self.size: int = len(vertex_data) + len(element_data)
 
-        self._vao = glGenVertexArrays(1)
-        self._vbo = glGenBuffers(1)
-        self._ebo = glGenBuffers(1)
-        glBindVertexArray(self._vao)
+        self._resources: GLResources = scene.assets.resources
+        self._vbo = self._resources.buffer(len(vertex_data))
+        self._ebo = self._resources.buffer(len(element_data))
+        # Vertex arrays are not shared between GL contexts, so each scene drawing the mesh gets its own
+        self._vaos: Dict[Scene, int] = {}
+        # (location, components, offset) of the vertex attributes
+        self._attributes: List[Tuple[int, int, int]] = []
 
         glBindBuffer(GL_ARRAY_BUFFER, self._vbo)
         glBufferData(GL_ARRAY_BUFFER, len(vertex_data), vertex_data, GL_STATIC_DRAW)
+        glBindBuffer(GL_ARRAY_BUFFER, 0)
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self._ebo)
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, len(element_data), element_data, GL_STATIC_DRAW)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0)
         self._face_count = len(element_data) // 2
 
         if data_bitflags & 0x0001:
-            glEnableVertexAttribArray(1)
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, block_size, ctypes.c_void_p(vertex_offset))
+            self._attributes.append((1, 3, vertex_offset))
 
         if data_bitflags & 0x0020 and texture != "" and texture != "NULL":
-            glEnableVertexAttribArray(3)
-            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, block_size, ctypes.c_void_p(texture_offset))
+            self._attributes.append((3, 2, texture_offset))
             self.texture = texture
 
         if data_bitflags & 0x0004 and lightmap != "" and lightmap != "NULL":
-            glEnableVertexAttribArray(4)
-            glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, block_size, ctypes.c_void_p(lightmap_offset))
+            self._attributes.append((4, 2, lightmap_offset))
             self.lightmap = lightmap
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0)
-        glBindVertexArray(0)
-
-    def draw(self, shader: Shader, transform: mat4, override_texture: Optional[str] = None):
-        shader.set_matrix4("model", transform)
-
-        glActiveTexture(GL_TEXTURE0)
-        self._scene.texture(self.texture if override_texture is None else override_texture).use()
-
-        glActiveTexture(GL_TEXTURE1)
-        self._scene.texture(self.lightmap).use()
-
-        glBindVertexArray(self._vao)
+        self._vertex_array(scene)
+
+    def _vertex_array(self, scene: Scene) -> int:
+        vao = self._vaos.get(scene)
+        if vao is None:
+            vao = self._resources.vertex_array(scene)
+            self._vaos[scene] = vao
+            glBindVertexArray(vao)
+            glBindBuffer(GL_ARRAY_BUFFER, self._vbo)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self._ebo)
+            for location, components, offset in self._attributes:
+                glEnableVertexAttribArray(location)
+                glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, self.mdx_size, ctypes.c_void_p(offset))
+            glBindBuffer(GL_ARRAY_BUFFER, 0)
+            glBindVertexArray(0)
+        return vao
+
+    def _drawing_scene(self) -> Scene:
+        # A model shared with other scenes is drawn by whichever of them is rendering
+        return self._scene.assets.drawing or self._scene
+
+    def _resolve_textures(self, scene: Scene) -> Tuple[Texture, Texture]:
+        textures = self._textures.get(scene)
+        if textures is None:
+            textures = (scene.texture(self.texture), scene.texture(self.lightmap))
+            self._textures[scene] = textures
+        return textures
+
+    def triangles(self, transform: mat4) -> numpy.ndarray:
+        """
+        Returns the transformed vertex positions of every triangle in an array of shape (triangles, 3, 3).
+        """
+        vertex_count = len(self.vertex_data) // self.mdx_size
+        positions = numpy.frombuffer(self.vertex_data, numpy.float32, vertex_count * self.mdx_size // 4)
+        positions = positions.reshape(vertex_count, self.mdx_size // 4)
+        positions = positions[:, self.mdx_vertex // 4:self.mdx_vertex // 4 + 3].astype(numpy.float64)
+        # Matrices are column major, so each row of the array is a column of the transform
+        matrix = numpy.frombuffer(transform.to_bytes(), numpy.float32).reshape(4, 4).astype(numpy.float64)
+        positions = positions @ matrix[:3, :3] + matrix[3, :3]
+
+        elements = numpy.frombuffer(self.element_data, numpy.uint16)
+        elements = elements[:len(elements) // 3 * 3].reshape(-1, 3)
+        elements = elements[(elements < vertex_count).all(axis=1)]
+        return positions[elements]
+
+    def sort_key(self, override_texture: Optional[Texture] = None) -> Tuple[int, int]:
+        """
+        Returns a key that is equal for meshes drawn with the same bound textures.
+        """
+        diffuse, lightmap = self._resolve_textures(self._drawing_scene())
+        diffuse = diffuse if override_texture is None else override_texture
+        return diffuse.id(), lightmap.id()
+
+    def detach(self, scene: Scene) -> None:
+        """
+        Deletes the vertex array of the given scene, whose GL context must be current.
+        """
+        self._textures.pop(scene, None)
+        vao = self._vaos.pop(scene, None)
+        if vao is not None:
+            self._resources.release(VERTEX_ARRAY, vao, scene)
+
+    def release(self) -> None:
+        """
+        Releases the buffers and every vertex array left.
+        """
+        for scene, vao in self._vaos.items():
+            self._resources.release(VERTEX_ARRAY, vao, scene)
+        self._vaos.clear()
+        self._textures.clear()
+        self._resources.release(BUFFER, self._vbo)
+        self._resources.release(BUFFER, self._ebo)
+
+    def draw(self, shader: Shader, transform: mat4, override_texture: Optional[Texture] = None):
+        scene = self._drawing_scene()
+        diffuse, lightmap = self._resolve_textures(scene)
+        diffuse = diffuse if override_texture is None else override_texture
+        scene.bind_texture(diffuse, DIFFUSE_UNIT)
+        scene.bind_texture(lightmap, LIGHTMAP_UNIT)
+        scene.uniforms.bind_object(transform, (diffuse.layer, lightmap.layer))
+
+        glBindVertexArray(self._vertex_array(scene))
         glDrawElements(GL_TRIANGLES, self._face_count, GL_UNSIGNED_SHORT, None)
+        scene.stats.frame.add_draw(self._face_count)
+
+    def draw_instanced(self, shader: Shader, transforms: List[mat4], override_texture: Optional[Texture] = None):
+        """
+        Draws the mesh once for every transform in as few instanced draw calls as possible.
+        """
+        scene = self._drawing_scene()
+        diffuse, lightmap = self._resolve_textures(scene)
+        diffuse = diffuse if override_texture is None else override_texture
+        scene.bind_texture(diffuse, DIFFUSE_UNIT)
+        scene.bind_texture(lightmap, LIGHTMAP_UNIT)
+
+        glBindVertexArray(self._vertex_array(scene))
+        for start in range(0, len(transforms), MAX_INSTANCES):
+            batch = transforms[start:start + MAX_INSTANCES]
+            scene.uniforms.bind_instances(batch, (diffuse.layer, lightmap.layer))
+            glDrawElementsInstanced(GL_TRIANGLES, self._face_count, GL_UNSIGNED_SHORT, None, len(batch))
+            scene.stats.frame.add_draw(self._face_count, len(batch))
 
 
 class Cube:
@@ -268,9 +450,10 @@ class Cube:
         self.min_point = min_point
         self.max_point = max_point
 
-        self._vao = glGenVertexArrays(1)
-        self._vbo = glGenBuffers(1)
-        self._ebo = glGenBuffers(1)
+        self._resources: GLResources = scene.assets.resources
+        self._vao = self._resources.vertex_array(scene)
+        self._vbo = self._resources.buffer(len(vertices)*4)
+        self._ebo = self._resources.buffer(len(elements)*4)
         glBindVertexArray(self._vao)
 
         glBindBuffer(GL_ARRAY_BUFFER, self._vbo)
@@ -287,9 +470,15 @@ class Cube:
         glBindVertexArray(0)
 
     def draw(self, shader: Shader, transform: mat4):
-        shader.set_matrix4("model", transform)
+        self._scene.uniforms.bind_object(transform)
         glBindVertexArray(self._vao)
         glDrawElements(GL_TRIANGLES, self._face_count, GL_UNSIGNED_SHORT, None)
+        self._scene.stats.frame.add_draw(self._face_count)
+
+    def release(self) -> None:
+        self._resources.release(VERTEX_ARRAY, self._vao, self._scene)
+        self._resources.release(BUFFER, self._vbo)
+        self._resources.release(BUFFER, self._ebo)
 
 
 class Boundary:
@@ -298,9 +487,10 @@ class Boundary:
 
         vertices, elements = self._build_nd(vertices)
 
-        self._vao = glGenVertexArrays(1)
-        self._vbo = glGenBuffers(1)
-        self._ebo = glGenBuffers(1)
+        self._resources: GLResources = scene.assets.resources
+        self._vao = self._resources.vertex_array(scene)
+        self._vbo = self._resources.buffer(len(vertices) * 4)
+        self._ebo = self._resources.buffer(len(elements) * 4)
         glBindVertexArray(self._vao)
 
         glBindBuffer(GL_ARRAY_BUFFER, self._vbo)
@@ -338,9 +528,15 @@ class Boundary:
         return Boundary(scene, vertices)
 
     def draw(self, shader: Shader, transform: mat4):
-        shader.set_matrix4("model", transform)
+        self._scene.uniforms.bind_object(transform)
         glBindVertexArray(self._vao)
         glDrawElements(GL_TRIANGLES, self._face_count, GL_UNSIGNED_SHORT, None)
+        self._scene.stats.frame.add_draw(self._face_count)
+
+    def release(self) -> None:
+        self._resources.release(VERTEX_ARRAY, self._vao, self._scene)
+        self._resources.release(BUFFER, self._vbo)
+        self._resources.release(BUFFER, self._ebo)
 
     def _build_nd(self, vertices) -> Tuple[ndarray, ndarray]:
         npvertices = []
@@ -363,3 +559,6 @@ class Empty:
 
     def draw(self, shader: Shader, transform: mat4):
         ...
+
+    def release(self) -> None:
+        ...
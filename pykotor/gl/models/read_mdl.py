@@ -1,8 +1,8 @@
 import struct
-from typing import List, Optional
+from typing import List, Optional, Set, Tuple
 
 import glm
-from glm import mat4, vec3, vec4
+from glm import mat4, vec3, vec4, quat
 from pykotor.common.stream import BinaryReader
 
 from pykotor.gl.models.mdl import Node, Mesh, Model
@@ -104,11 +104,62 @@ def gl_load_mdl(scene, mdl: BinaryReader, mdx: BinaryReader) -> Model:
     return Model(scene, _load_node(scene, None, mdl, mdx, offset, names))
 
 
+class StitchedModelData:
+    """
+    A parsed model without any GL objects, so it can be read on a worker thread.
+    """
+
+    def __init__(self):
+        # (name, position, rotation) of the hooks other models attach to
+        self.hooks: List[Tuple[str, vec3, quat]] = []
+        # (texture, lightmap, vertex data, element data, MDX data flags) of each merged mesh
+        self.meshes: List[Tuple[str, str, bytes, bytes, int]] = []
+
+    def textures(self) -> Set[str]:
+        """
+        Returns the names of the textures and lightmaps the meshes will be drawn with.
+        """
+        names = set()
+        for texture, lightmap, _, _, data_bitflags in self.meshes:
+            if data_bitflags & 0x0020 and texture not in ("", "NULL"):
+                names.add(texture)
+            if data_bitflags & 0x0004 and lightmap not in ("", "NULL"):
+                names.add(lightmap)
+        return names
+
+
 def gl_load_stitched_model(scene, mdl: BinaryReader, mdx: BinaryReader) -> Model:
     """
     Returns a model instance that has meshes with the same textures merged together.
     """
+    return build_stitched_model(scene, parse_stitched_model(mdl, mdx))
+
+
+def build_stitched_model(scene, data: StitchedModelData) -> Model:
+    """
+    Creates the nodes and uploads the meshes of a parsed model; the scene's context must be current.
+    """
     root = Node(scene, None, "root")
+    for name, position, rotation in data.hooks:
+        node = Node(scene, root, name)
+        node._position = position
+        node._rotation = rotation
+        node._recalc_transform()
+        root.children.append(node)
+
+    for texture, lightmap, vertex_data, element_data, data_bitflags in data.meshes:
+        child = Node(scene, root, "child")
+        root.children.append(child)
+        child.mesh = Mesh(scene, child, texture, lightmap, vertex_data, element_data, 40, data_bitflags, 0, 12, 24, 32)
+
+    return Model(scene, root)
+
+
+def parse_stitched_model(mdl: BinaryReader, mdx: BinaryReader) -> StitchedModelData:
+    """
+    Reads the hooks and meshes of a model, merging meshes with the same textures, without touching GL state.
+    """
+    data = StitchedModelData()
 
     mdl.seek(40)
     offset = mdl.read_uint32()
@@ -157,10 +208,9 @@ def gl_load_stitched_model(scene, mdl: BinaryReader, mdx: BinaryReader) -> Model
                 offsets.append((offset, transform))
 
         if names[name_id].lower() in ["headhook", "rhand", "lhand", "gogglehook", "maskhook"]:
-            node = Node(scene, root, names[name_id])
-            root.children.append(node)
-            glm.decompose(transform, vec3(), node._rotation, node._position, vec3(), vec4())
-            node._recalc_transform()
+            hook_position, hook_rotation = vec3(), quat()
+            glm.decompose(transform, vec3(), hook_rotation, hook_position, vec3(), vec4())
+            data.hooks.append((names[name_id], hook_position, hook_rotation))
 
     merged = {}
     for offset, transform in offsets:
@@ -175,8 +225,6 @@ def gl_load_stitched_model(scene, mdl: BinaryReader, mdx: BinaryReader) -> Model
     for key, value in merged.items():
         vertex_data = bytearray()
         elements = []
-        child = Node(scene, root, "child")
-        root.children.append(child)
 
         last_element = 0
         for offset, transform in value:
@@ -247,6 +295,6 @@ def gl_load_stitched_model(scene, mdl: BinaryReader, mdx: BinaryReader) -> Model
             element_data += struct.pack('H', element)
 
         texture, lightmap = key.split("\n")
-        child.mesh = Mesh(scene, child, texture, lightmap, vertex_data, element_data, 40, mdx_data_bitflags, 0, 12, 24, 32)
+        data.meshes.append((texture, lightmap, bytes(vertex_data), bytes(element_data), mdx_data_bitflags))
 
-    return Model(scene, root)
+    return data
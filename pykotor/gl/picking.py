@@ -0,0 +1,272 @@
+from __future__ import annotations
+
+import ctypes
+from typing import Any, Optional, Tuple
+
+import numpy
+from glm import mat4
+from OpenGL.GL import glClearBufferuiv, glGetIntegerv, glGetFramebufferAttachmentParameteriv
+from OpenGL.raw.GL.VERSION.GL_1_0 import GL_UNSIGNED_INT, GL_DEPTH_BUFFER_BIT, GL_VIEWPORT, GL_COLOR, glViewport, \
+    glClear, glReadPixels, GL_DEPTH_COMPONENT, GL_FLOAT, GL_NEAREST, GL_DEPTH, GL_STENCIL, GL_NONE
+from OpenGL.raw.GL.VERSION.GL_1_3 import GL_SAMPLES
+from OpenGL.raw.GL.VERSION.GL_1_4 import GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32
+from OpenGL.raw.GL.VERSION.GL_3_0 import glBindFramebuffer, glBindRenderbuffer, glRenderbufferStorage, \
+    glFramebufferRenderbuffer, glCheckFramebufferStatus, glBlitFramebuffer, GL_FRAMEBUFFER, GL_READ_FRAMEBUFFER, \
+    GL_DRAW_FRAMEBUFFER, GL_RENDERBUFFER, GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_COMPLETE, \
+    GL_DEPTH_COMPONENT32F, GL_R32UI, GL_RED_INTEGER, GL_DEPTH32F_STENCIL8, GL_DEPTH24_STENCIL8, \
+    GL_UNSIGNED_NORMALIZED, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, \
+    GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE
+
+from pykotor.gl.buffer import ReadbackBuffer
+from pykotor.gl.framebuffer import framebuffer_bindings
+from pykotor.gl.resources import GLResources, FRAMEBUFFER, RENDERBUFFER
+
+
+# Renderbuffer formats matching a depth buffer, by (component type, depth bits, whether it has stencil bits)
+DEPTH_FORMATS = {
+    (GL_FLOAT, 32, False): GL_DEPTH_COMPONENT32F,
+    (GL_FLOAT, 32, True): GL_DEPTH32F_STENCIL8,
+    (GL_UNSIGNED_NORMALIZED, 16, False): GL_DEPTH_COMPONENT16,
+    (GL_UNSIGNED_NORMALIZED, 24, False): GL_DEPTH_COMPONENT24,
+    (GL_UNSIGNED_NORMALIZED, 24, True): GL_DEPTH24_STENCIL8,
+    (GL_UNSIGNED_NORMALIZED, 32, False): GL_DEPTH_COMPONENT32,
+}
+
+
+def depth_format(framebuffer: int) -> Optional[Tuple[int, int]]:
+    """
+    Returns the renderbuffer format and sample count of the bound framebuffer's depth buffer, or None if it cannot be
+    copied.
+    """
+    # The default framebuffer names its buffers rather than its attachment points
+    depth, stencil = (GL_DEPTH, GL_STENCIL) if framebuffer == 0 else (GL_DEPTH_ATTACHMENT, GL_DEPTH_ATTACHMENT)
+    if _attachment_parameter(depth, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE) == GL_NONE:
+        return None
+    has_stencil = _attachment_parameter(stencil, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE) != GL_NONE \
+        and _attachment_parameter(stencil, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE) > 0
+    key = (_attachment_parameter(depth, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE),
+           _attachment_parameter(depth, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE), has_stencil)
+    if key not in DEPTH_FORMATS:
+        return None
+    return DEPTH_FORMATS[key], int(glGetIntegerv(GL_SAMPLES))
+
+
+def _attachment_parameter(attachment: int, parameter: int) -> int:
+    return int(glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, parameter))
+
+
+def _attach_depth(fbo: int, renderbuffer: int, internal_format: int, width: int, height: int) -> None:
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer)
+    glRenderbufferStorage(GL_RENDERBUFFER, internal_format, width, height)
+    glBindRenderbuffer(GL_RENDERBUFFER, 0)
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo)
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer)
+    status = glCheckFramebufferStatus(GL_FRAMEBUFFER)
+    if status != GL_FRAMEBUFFER_COMPLETE:
+        raise RuntimeError("Depth snapshot is incomplete (status 0x{:X}).".format(status))
+
+
+class PickBuffer:
+    """
+    An offscreen R32UI buffer holding the ID of the object drawn at each pixel, read back without stalling through a
+    fence.
+    """
+
+    def __init__(self, width: int, height: int, resources: GLResources, owner: Any):
+        self.width: int = 0
+        self.height: int = 0
+        # State of the scene the IDs were rendered for; None forces the next pick to render them again
+        self.key: Any = None
+        self.resources: GLResources = resources
+        self._owner: Any = owner
+        self._fbo: int = resources.framebuffer(owner)
+        self._ids: int = resources.renderbuffer()
+        self._depth: int = resources.renderbuffer()
+        self._readback: ReadbackBuffer = ReadbackBuffer(resources, 4)
+        self._pending: bool = False
+        self._previous: Tuple[int, int, Any] = (0, 0, None)
+        self.resize(width, height)
+
+    def resize(self, width: int, height: int) -> None:
+        if (width, height) == (self.width, self.height):
+            return
+        self.width, self.height = width, height
+        self.key = None
+
+        glBindRenderbuffer(GL_RENDERBUFFER, self._ids)
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height)
+        glBindRenderbuffer(GL_RENDERBUFFER, self._depth)
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height)
+        glBindRenderbuffer(GL_RENDERBUFFER, 0)
+        self.resources.resize(RENDERBUFFER, self._ids, width * height * 4)
+        self.resources.resize(RENDERBUFFER, self._depth, width * height * 4)
+
+        draw, read = framebuffer_bindings()
+        glBindFramebuffer(GL_FRAMEBUFFER, self._fbo)
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, self._ids)
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, self._depth)
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+        if status != GL_FRAMEBUFFER_COMPLETE:
+            raise RuntimeError("Pick buffer is incomplete (status 0x{:X}).".format(status))
+
+    def bind(self) -> None:
+        """
+        Binds and clears the buffer for rendering IDs; unbind() restores the previous framebuffers and viewport.
+        """
+        draw, read = framebuffer_bindings()
+        self._previous = (draw, read, glGetIntegerv(GL_VIEWPORT))
+        glBindFramebuffer(GL_FRAMEBUFFER, self._fbo)
+        glViewport(0, 0, self.width, self.height)
+        glClearBufferuiv(GL_COLOR, 0, numpy.zeros(4, numpy.uint32))
+        glClear(GL_DEPTH_BUFFER_BIT)
+
+    def unbind(self) -> None:
+        draw, read, viewport = self._previous
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+        if viewport is not None:
+            glViewport(*[int(value) for value in viewport])
+
+    def request(self, x: int, y: int) -> bool:
+        """
+        Starts reading the ID at the given window coordinates, or returns False if the previous request is still
+        pending.
+        """
+        if self._pending:
+            return False
+        x, y = min(max(x, 0), self.width - 1), min(max(y, 0), self.height - 1)
+
+        _, read = framebuffer_bindings()
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, self._fbo)
+        self._readback.bind()
+        glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, ctypes.c_void_p(0))
+        self._readback.unbind()
+        self._readback.fence()
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+        self._pending = True
+        return True
+
+    def poll(self) -> Optional[int]:
+        """
+        Returns the ID read by the last request() once the GPU has written it, or None.
+        """
+        if not self._pending or not self._readback.ready():
+            return None
+        self._pending = False
+        return int(self._readback.read(0, 4).view(numpy.uint32)[0])
+
+    def read(self, x: int, y: int) -> int:
+        """
+        Returns the ID at the given window coordinates, waiting for the GPU.
+        """
+        self._pending = False
+        self.request(x, y)
+        self._readback.wait()
+        return self.poll()
+
+    def release(self) -> None:
+        self._readback.release()
+        self.resources.release(FRAMEBUFFER, self._fbo, self._owner)
+        self.resources.release(RENDERBUFFER, self._ids)
+        self.resources.release(RENDERBUFFER, self._depth)
+
+
+class DepthSnapshot:
+    """
+    A downscaled copy of a depth buffer read back once per frame, so screen to world queries never wait for the GPU.
+    """
+
+    def __init__(self, resources: GLResources, owner: Any, scale: int = 4):
+        self.scale: int = scale
+        self.resources: GLResources = resources
+        self._owner: Any = owner
+        # Size of the framebuffer the depth was captured from, which depth_at() takes coordinates in
+        self.width: int = 0
+        self.height: int = 0
+        self.depth: Optional[numpy.ndarray] = None
+        self.view: mat4 = mat4()
+        self.projection: mat4 = mat4()
+        self._fbo: int = resources.framebuffer(owner)
+        self._depth: int = resources.renderbuffer()
+        self._resolve_fbo: int = resources.framebuffer(owner)
+        self._resolve: int = resources.renderbuffer()
+        self._readback: ReadbackBuffer = ReadbackBuffer(resources, 4)
+        # (snapshot size, source size, depth format, source samples) the renderbuffers were allocated for
+        self._layout: Tuple = ()
+        self._pending: Optional[Tuple[int, int, mat4, mat4]] = None
+
+    def _resize(self, size: Tuple[int, int], source_size: Tuple[int, int], depth_format: int, samples: int) -> None:
+        self._layout = (size, source_size, depth_format, samples)
+        draw, read = framebuffer_bindings()
+        _attach_depth(self._fbo, self._depth, depth_format, *size)
+        if samples > 0:
+            _attach_depth(self._resolve_fbo, self._resolve, depth_format, *source_size)
+        self.resources.resize(RENDERBUFFER, self._depth, size[0] * size[1] * 4)
+        self.resources.resize(RENDERBUFFER, self._resolve, source_size[0] * source_size[1] * 4 if samples > 0 else 0)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+        self._readback.resize(size[0] * size[1] * 4)
+
+    def capture(self, source: int, width: int, height: int, view: mat4, projection: mat4) -> None:
+        """
+        Starts reading the depth of the given framebuffer unless the previous capture is still in flight.
+        """
+        self.poll()
+        if self._pending is not None:
+            return
+
+        draw, read = framebuffer_bindings()
+        glBindFramebuffer(GL_FRAMEBUFFER, source)
+        found = depth_format(source)
+        if found is not None:
+            size = (max(1, width // self.scale), max(1, height // self.scale))
+            if (size, (width, height), *found) != self._layout:
+                self._resize(size, (width, height), *found)
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, source)
+            if found[1] > 0:
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, self._resolve_fbo)
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST)
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, self._resolve_fbo)
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, self._fbo)
+            glBlitFramebuffer(0, 0, width, height, 0, 0, *size, GL_DEPTH_BUFFER_BIT, GL_NEAREST)
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, self._fbo)
+            self._readback.bind()
+            glReadPixels(0, 0, *size, GL_DEPTH_COMPONENT, GL_FLOAT, ctypes.c_void_p(0))
+            self._readback.unbind()
+            self._readback.fence()
+            self._pending = (width, height, view, projection)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read)
+
+    def poll(self) -> bool:
+        """
+        Takes the result of the last capture if the GPU has written it and returns whether the depth was updated.
+        """
+        if self._pending is None or not self._readback.ready():
+            return False
+        self.width, self.height, self.view, self.projection = self._pending
+        self._pending = None
+        width, height = self._layout[0]
+        # Copied out since the next capture writes into the same memory
+        self.depth = self._readback.read(0, width * height * 4).view(numpy.float32).reshape(height, width).copy()
+        return True
+
+    def depth_at(self, x: int, y: int) -> Optional[float]:
+        """
+        Returns the window-space depth at the given coordinates, or None if none has been captured there.
+        """
+        if self.depth is None or not (0 <= x < self.width and 0 <= y < self.height):
+            return None
+        rows, columns = self.depth.shape
+        return float(self.depth[min(int(y) * rows // self.height, rows - 1),
+                                min(int(x) * columns // self.width, columns - 1)])
+
+    def release(self) -> None:
+        self._readback.release()
+        for fbo in (self._fbo, self._resolve_fbo):
+            self.resources.release(FRAMEBUFFER, fbo, self._owner)
+        for renderbuffer in (self._depth, self._resolve):
+            self.resources.release(RENDERBUFFER, renderbuffer)
@@ -0,0 +1,30 @@
+from __future__ import annotations
+
+import struct
+import zlib
+
+import numpy
+
+
+def encode_png(pixels: numpy.ndarray, compression: int = 6) -> bytes:
+    """
+    Encodes an image of shape (height, width, 3) or (height, width, 4) in uint8 as an RGB or RGBA PNG.
+    """
+    height, width, channels = pixels.shape
+    color_type = {3: 2, 4: 6}[channels]
+
+    # Every row is prefixed with filter type 0 (none)
+    rows = numpy.zeros((height, width * channels + 1), numpy.uint8)
+    rows[:, 1:] = numpy.ascontiguousarray(pixels).reshape(height, width * channels)
+
+    def chunk(kind: bytes, data: bytes) -> bytes:
+        return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF)
+
+    header = struct.pack(">IIBBBBB", width, height, 8, color_type, 0, 0, 0)
+    return b"\x89PNG\r\n\x1a\n" + chunk(b"IHDR", header) + chunk(b"IDAT", zlib.compress(rows.tobytes(), compression)) \
+        + chunk(b"IEND", b"")
+
+
+def write_png(path: str, pixels: numpy.ndarray, compression: int = 6) -> None:
+    with open(path, "wb") as file:
+        file.write(encode_png(pixels, compression))
@@ -0,0 +1,33 @@
+from __future__ import annotations
+
+from concurrent.futures import Future
+from typing import Callable, List, Optional, Set
+
+
+class ModulePrefetch:
+    """
+    What Scene.prefetchModule() is loading, advanced by the scene once per frame.
+    """
+
+    def __init__(self, scan: Future, progress: Optional[Callable[[int, int], None]] = None):
+        self.scan: Optional[Future] = scan
+        self.progress: Optional[Callable[[int, int], None]] = progress
+        # Lowercase names
+        self.models: Set[str] = set()
+        self.built: Set[str] = set()
+        self.textures: Set[str] = set()
+        self._reported: Optional[List[int]] = None
+
+    def report(self, textures_loaded: int) -> bool:
+        """
+        Calls the progress callback if the counts changed and returns whether everything has been loaded.
+        """
+        loaded, total = len(self.built) + textures_loaded, len(self.models) + len(self.textures)
+        if self.progress is not None and [loaded, total] != self._reported:
+            self._reported = [loaded, total]
+            self.progress(loaded, total)
+        return self.scan is None and loaded == total
+
+    def cancel(self) -> None:
+        if self.scan is not None:
+            self.scan.cancel()
@@ -0,0 +1,123 @@
+"""
+Renders a top-down map of every module in an installation to PNG files, without a display.
+
+    pykotor-render-modules <installation> <output directory> [--size 1024 1024] [--processes 4] [--modules m01aa ...]
+        [--cache-dir <directory>] [--transcode]
+
+Each module is opened through Scene, framed with an orthographic camera fitted to its rooms and rendered offscreen.
+Modules are spread over a pool of processes with one headless context each. With --cache-dir, the resource index and
+the parsed models are kept in a directory shared by every process and by later runs: the index is built once before
+the workers start, and a model parsed by one worker is read back by the others. --transcode compresses uncompressed
+textures to DXT1/DXT5, which is lossy and so changes the images; with --cache-dir the compressed copies are shared
+too.
+"""
+from __future__ import annotations
+
+from pykotor.gl import headless
+
+# Renders on the GPU where there is one; only the benchmarks pin llvmpipe
+headless.configure(software=False)
+
+import argparse
+import multiprocessing
+import os
+import sys
+import time
+import traceback
+from typing import List, Optional, Tuple
+
+from pykotor.common.module import Module
+from pykotor.extract.installation import Installation
+
+from pykotor.gl.model_cache import ModelCache
+from pykotor.gl.png import write_png
+from pykotor.gl.resource_index import ResourceIndex
+from pykotor.gl.scene import Scene
+from pykotor.gl.transcode import TextureTranscoder
+
+_installation: Optional[Installation] = None
+_context: Optional[headless.HeadlessContext] = None
+_scene: Optional[Scene] = None
+_options: Optional[argparse.Namespace] = None
+
+
+def _init_worker(options: argparse.Namespace) -> None:
+    global _installation, _context, _scene, _options
+    _options = options
+    _installation = Installation(options.installation)
+    _context = headless.HeadlessContext(*options.size)
+
+    # One scene per process, so models and textures shared between modules stay loaded
+    _scene = _context.scene(installation=_installation, index_resources=options.cache_dir is None)
+    if options.cache_dir is not None:
+        _scene.resource_index = ResourceIndex(_installation, os.path.join(options.cache_dir, "index"))
+        _scene.model_cache = ModelCache(os.path.join(options.cache_dir, "models"))
+    if options.transcode:
+        _scene.transcoder = TextureTranscoder(os.path.join(options.cache_dir, "bcn") if options.cache_dir else None)
+    _scene.show_cursor = False
+    _scene.vis_culling = False
+    for category in ["triggers", "encounters", "waypoints", "sounds", "stores", "cameras"]:
+        setattr(_scene, "hide_" + category, True)
+    if options.rooms_only:
+        _scene.hide_creatures = _scene.hide_placeables = _scene.hide_doors = True
+
+
+def render_module(root: str) -> Tuple[str, float, Optional[str]]:
+    """
+    Renders one module in the worker process and returns (root, seconds taken, error message or None).
+    """
+    start = time.perf_counter()
+    try:
+        _scene.setModule(Module(root, _installation))
+        _scene.frameTopDown(_options.margin)
+        _scene.render()
+
+        write_png(os.path.join(_options.output, root + ".png"), _scene.framebuffer.read_color())
+        return root, time.perf_counter() - start, None
+    except Exception:
+        return root, time.perf_counter() - start, traceback.format_exc()
+
+
+def module_roots(installation: Installation) -> List[str]:
+    return sorted({Module.get_root(filename) for filename in installation.modules_list()})
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("installation", help="path to the game directory")
+    parser.add_argument("output", help="directory the PNG files are written to")
+    parser.add_argument("--size", type=int, nargs=2, default=[1024, 1024], metavar=("WIDTH", "HEIGHT"))
+    parser.add_argument("--processes", type=int, default=os.cpu_count())
+    parser.add_argument("--modules", nargs="+", help="module roots to render instead of every module")
+    parser.add_argument("--margin", type=float, default=0.05, help="space left around the rooms, as a fraction")
+    parser.add_argument("--rooms-only", action="store_true", help="leave out creatures, placeables and doors")
+    parser.add_argument("--cache-dir", help="share the resource index and parsed models through this directory")
+    parser.add_argument("--transcode", action="store_true", help="compress uncompressed textures to DXT1/DXT5; lossy")
+    options = parser.parse_args(sys.argv[1:] if argv is None else argv)
+
+    os.makedirs(options.output, exist_ok=True)
+    installation = Installation(options.installation)
+    roots = options.modules if options.modules else module_roots(installation)
+    if options.cache_dir is not None:
+        # Saves the index before the workers start, so they all load it instead of each building their own
+        ResourceIndex(installation, os.path.join(options.cache_dir, "index"))
+
+    start = time.perf_counter()
+    failed = 0
+    # Spawned rather than forked, so no worker inherits PyOpenGL state from the parent
+    with multiprocessing.get_context("spawn").Pool(options.processes, _init_worker, (options,)) as pool:
+        for root, seconds, error in pool.imap_unordered(render_module, roots):
+            if error is None:
+                print("{}: {:.2f}s".format(root, seconds))
+            else:
+                failed += 1
+                print("{}: failed\n{}".format(root, error), file=sys.stderr)
+    elapsed = time.perf_counter() - start
+
+    rendered = len(roots) - failed
+    print("Rendered {} of {} modules in {:.1f}s ({:.1f} modules per minute)".format(
+        rendered, len(roots), elapsed, rendered / elapsed * 60 if elapsed > 0 else 0.0))
+
+
+if __name__ == "__main__":
+    main()
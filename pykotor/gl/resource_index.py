@@ -0,0 +1,208 @@
+from __future__ import annotations
+
+import hashlib
+import json
+import os
+import tempfile
+import time
+from typing import Any, Dict, List, Optional, Tuple
+
+from pykotor.extract.installation import Installation, SearchLocation
+from pykotor.resource.type import ResourceType
+
+INDEX_VERSION = 1
+
+# (resref, extension), both lower case
+Key = Tuple[str, str]
+# (path, offset, size); size is None for loose files, which are read whole
+Location = Tuple[str, int, Optional[int]]
+
+
+def _stamp(path: str) -> Optional[List[int]]:
+    try:
+        stat = os.stat(path)
+    except OSError:
+        return None
+    return [stat.st_mtime_ns, stat.st_size]
+
+
+def _extension(restype: ResourceType) -> str:
+    return restype.extension.lower()
+
+
+class ResourceIndex:
+    """
+    Maps (resref, type) to the file, offset and size a resource is read from, in the search order of
+    Installation.resource().
+    """
+
+    def __init__(self, installation: Installation, cache_dir: Optional[str] = None, refresh_interval: float = 2.0):
+        self.installation: Installation = installation
+        self.cache_dir: str = cache_dir if cache_dir is not None else \
+            os.path.join(os.path.expanduser("~"), ".cache", "pykotor", "index")
+        # Seconds between the directory checks of refresh(); 0 checks on every call
+        self.refresh_interval: float = refresh_interval
+        self._tables: Dict[SearchLocation, Dict[Key, Location]] = {location: {} for location in (
+            SearchLocation.CUSTOM_MODULES, SearchLocation.OVERRIDE, SearchLocation.TEXTURES_TPA,
+            SearchLocation.CHITIN)}
+        self._override_built: bool = False
+        self._last_refresh: float = 0.0
+        self._saved: Dict[str, Any] = {}
+        self._load()
+        self._index_chitin()
+        self._index_texture_pack()
+        self._index_override()
+        self._save()
+
+    def locate(self, resname: str, restypes: List[ResourceType],
+               order: List[SearchLocation]) -> Optional[Tuple[ResourceType, Location]]:
+        """
+        Returns the type and location of the first of the resource types found, or None.
+        """
+        resname = resname.lower()
+        for search_location in order:
+            table = self._tables.get(search_location)
+            if table is None:
+                continue
+            for restype in restypes:
+                location = table.get((resname, _extension(restype)))
+                if location is not None:
+                    return restype, location
+        return None
+
+    def data(self, resname: str, restype: ResourceType, order: List[SearchLocation]) -> Optional[bytes]:
+        found = self.locate(resname, [restype], order)
+        return self.read(found[1]) if found is not None else None
+
+    @staticmethod
+    def read(location: Location) -> bytes:
+        path, offset, size = location
+        with open(path, "rb") as file:
+            if size is None:
+                return file.read()
+            file.seek(offset)
+            return file.read(size)
+
+    def set_capsules(self, capsules: List[Any]) -> None:
+        """
+        Replaces the CUSTOM_MODULES table with the resources of the given capsules, earlier capsules winning.
+        """
+        saved = self._saved.setdefault("capsules", {})
+        table = {}
+        changed = False
+        for capsule in reversed(capsules):
+            path = str(capsule.path())
+            stamp = _stamp(path)
+            entry = saved.get(path)
+            if entry is None or entry["stamp"] != stamp:
+                entry = {"stamp": stamp, "entries": [[str(resource.resname()).lower(), _extension(resource.restype()),
+                                                      resource.offset(), resource.size()] for resource in capsule]}
+                saved[path] = entry
+                changed = True
+            table.update(((resname, extension), (path, offset, size))
+                         for resname, extension, offset, size in entry["entries"])
+        self._tables[SearchLocation.CUSTOM_MODULES] = table
+        if changed:
+            self._save()
+
+    def refresh(self, force: bool = False) -> bool:
+        """
+        Rescans the override directories that changed and returns whether the override table changed.
+        """
+        now = time.perf_counter()
+        if not force and now - self._last_refresh < self.refresh_interval:
+            return False
+        self._last_refresh = now
+        changed = self._index_override()
+        if changed:
+            self._save()
+        return changed
+
+    def _index_chitin(self) -> None:
+        path = os.path.join(self.installation.path(), "chitin.key")
+        self._tables[SearchLocation.CHITIN] = self._archive("chitin", _stamp(path), self.installation.chitin_resources)
+
+    def _index_texture_pack(self) -> None:
+        path = os.path.join(self.installation.path(), "TexturePacks", "swpc_tex_tpa.erf")
+        self._tables[SearchLocation.TEXTURES_TPA] = self._archive(
+            "texture_pack", _stamp(path), lambda: self.installation.texturepack_resources("swpc_tex_tpa.erf"))
+
+    def _archive(self, name: str, stamp: Optional[List[int]], resources: Any) -> Dict[Key, Location]:
+        entry = self._saved.get(name)
+        if entry is None or entry["stamp"] != stamp:
+            files: Dict[str, int] = {}
+            entries = []
+            for resource in resources():
+                path = str(resource.filepath())
+                entries.append([str(resource.resname()).lower(), _extension(resource.restype()),
+                                files.setdefault(path, len(files)), resource.offset(), resource.size()])
+            entry = {"stamp": stamp, "files": list(files), "entries": entries}
+            self._saved[name] = entry
+
+        files = entry["files"]
+        table = {}
+        # The first entry wins, as it does when Installation.resource() searches the list
+        for resname, extension, file, offset, size in entry["entries"]:
+            table.setdefault((resname, extension), (files[file], offset, size))
+        return table
+
+    def _index_override(self) -> bool:
+        saved = self._saved.get("override", {})
+        directories: Dict[str, Dict[str, Any]] = {}
+        changed = False
+        pending = [str(self.installation.override_path())]
+        while pending:
+            directory = pending.pop()
+            stamp = _stamp(directory)
+            if stamp is None:
+                continue
+            entry = saved.get(directory)
+            if entry is None or entry["stamp"] != stamp:
+                entry = {"stamp": stamp, "files": [], "dirs": []}
+                with os.scandir(directory) as scan:
+                    for item in scan:
+                        if item.is_dir():
+                            entry["dirs"].append(item.path)
+                            continue
+                        resname, _, extension = item.name.rpartition(".")
+                        if resname:
+                            entry["files"].append([resname.lower(), extension.lower(), item.path])
+                changed = True
+            directories[directory] = entry
+            pending.extend(entry["dirs"])
+
+        changed = changed or directories.keys() != saved.keys()
+        if changed or not self._override_built:
+            self._saved["override"] = directories
+            table = {}
+            # Deeper directories go first, so files directly in the override folder win over ones in subfolders
+            for directory in sorted(directories, key=lambda path: (-path.count(os.sep), path)):
+                table.update(((resname, extension), (path, 0, None))
+                             for resname, extension, path in directories[directory]["files"])
+            self._tables[SearchLocation.OVERRIDE] = table
+            self._override_built = True
+        return changed
+
+    def _path(self) -> str:
+        digest = hashlib.sha1(os.path.abspath(str(self.installation.path())).encode())
+        return os.path.join(self.cache_dir, digest.hexdigest() + ".json")
+
+    def _load(self) -> None:
+        try:
+            with open(self._path()) as file:
+                saved = json.load(file)
+        except (OSError, ValueError):
+            return
+        if saved.get("version") == INDEX_VERSION:
+            self._saved = saved
+
+    def _save(self) -> None:
+        # Written to a temporary file first, so another process never reads a partial index
+        try:
+            os.makedirs(self.cache_dir, exist_ok=True)
+            fd, temp_path = tempfile.mkstemp(dir=self.cache_dir, suffix=".tmp")
+            with os.fdopen(fd, "w") as file:
+                json.dump({**self._saved, "version": INDEX_VERSION}, file)
+            os.replace(temp_path, self._path())
+        except OSError:
+            pass
@@ -0,0 +1,154 @@
+from __future__ import annotations
+
+from typing import Any, Dict, List, Tuple
+
+import numpy
+from OpenGL.GL import glGenTextures, glGenBuffers, glGenVertexArrays, glDeleteTextures, glDeleteBuffers, \
+    glDeleteVertexArrays, glDeleteProgram, glGenFramebuffers, glDeleteFramebuffers, glGenRenderbuffers, \
+    glDeleteRenderbuffers, glGenQueries, glDeleteQueries
+from OpenGL.raw.GL.VERSION.GL_3_2 import glFenceSync, glClientWaitSync, glDeleteSync, GL_SYNC_GPU_COMMANDS_COMPLETE, \
+    GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_EXPIRED
+
+TEXTURE = "texture"
+BUFFER = "buffer"
+VERTEX_ARRAY = "vertex_array"
+PROGRAM = "program"
+FRAMEBUFFER = "framebuffer"
+RENDERBUFFER = "renderbuffer"
+QUERY = "query"
+
+# (kind, GL name, owner); the owner is the scene whose GL context a vertex array, framebuffer or query belongs to and
+# None for everything else, since only those kinds are not shared between contexts
+Key = Tuple[str, int, Any]
+
+
+class GLResources:
+    """
+    Keeps track of the GL objects of an AssetContext and deletes released ones once the GPU is done with them.
+    """
+
+    def __init__(self):
+        # Bytes of each live object, or 0 where the size is not known
+        self._live: Dict[Key, int] = {}
+        self._released: List[Key] = []
+        self._fenced: List[Tuple[int, List[Key]]] = []
+        # Released, past their fence, and waiting for a collect() by their owner
+        self._ready: List[Key] = []
+
+    def __len__(self) -> int:
+        return len(self._live)
+
+    def texture(self, size: int = 0) -> int:
+        return self.track(TEXTURE, glGenTextures(1), size)
+
+    def buffer(self, size: int = 0) -> int:
+        return self.track(BUFFER, glGenBuffers(1), size)
+
+    def vertex_array(self, owner: Any) -> int:
+        return self.track(VERTEX_ARRAY, glGenVertexArrays(1), 0, owner)
+
+    def framebuffer(self, owner: Any) -> int:
+        return self.track(FRAMEBUFFER, glGenFramebuffers(1), 0, owner)
+
+    def renderbuffer(self, size: int = 0) -> int:
+        return self.track(RENDERBUFFER, glGenRenderbuffers(1), size)
+
+    def queries(self, count: int, owner: Any) -> List[int]:
+        return [self.track(QUERY, int(query), 0, owner) for query in numpy.atleast_1d(glGenQueries(count))]
+
+    def track(self, kind: str, name: int, size: int = 0, owner: Any = None) -> int:
+        """
+        Takes over an object created elsewhere and returns its name.
+        """
+        self._live[(kind, int(name), owner)] = size
+        return name
+
+    def resize(self, kind: str, name: int, size: int, owner: Any = None) -> None:
+        key = (kind, int(name), owner)
+        if key in self._live:
+            self._live[key] = size
+
+    def release(self, kind: str, name: int, owner: Any = None) -> None:
+        """
+        Marks the object for deletion after the current frame.
+        """
+        key = (kind, int(name), owner)
+        if self._live.pop(key, None) is not None:
+            self._released.append(key)
+
+    def end_frame(self) -> None:
+        """
+        Fences the objects released since the last call.
+        """
+        if self._released:
+            self._fenced.append((glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), self._released))
+            self._released = []
+
+    def collect(self, owner: Any = None) -> int:
+        """
+        Deletes the released objects the GPU is done with and returns how many were deleted.
+        """
+        while self._fenced and glClientWaitSync(self._fenced[0][0], 0, 0) != GL_TIMEOUT_EXPIRED:
+            fence, keys = self._fenced.pop(0)
+            glDeleteSync(fence)
+            self._ready.extend(keys)
+        return self._delete(owner)
+
+    def flush(self, owner: Any = None) -> int:
+        """
+        Waits for the GPU and deletes every released object of the given owner.
+        """
+        self.end_frame()
+        for fence, keys in self._fenced:
+            while glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED:
+                pass
+            glDeleteSync(fence)
+            self._ready.extend(keys)
+        self._fenced = []
+        return self._delete(owner)
+
+    def pending(self) -> int:
+        """
+        Returns the number of objects released but not deleted yet.
+        """
+        return len(self._released) + sum(len(keys) for fence, keys in self._fenced) + len(self._ready)
+
+    def report(self) -> Dict[str, Tuple[int, int]]:
+        """
+        Returns the number of live objects and the bytes they occupy, by kind.
+        """
+        report: Dict[str, Tuple[int, int]] = {}
+        for (kind, name, owner), size in self._live.items():
+            count, total = report.get(kind, (0, 0))
+            report[kind] = (count + 1, total + size)
+        return report
+
+    def size(self) -> int:
+        return sum(self._live.values())
+
+    def _delete(self, owner: Any) -> int:
+        deleted: Dict[str, List[int]] = {}
+        kept: List[Key] = []
+        for key in self._ready:
+            kind, name, key_owner = key
+            if key_owner is not None and key_owner is not owner:
+                kept.append(key)
+            else:
+                deleted.setdefault(kind, []).append(name)
+        self._ready = kept
+
+        if TEXTURE in deleted:
+            glDeleteTextures(deleted[TEXTURE])
+        if BUFFER in deleted:
+            glDeleteBuffers(len(deleted[BUFFER]), deleted[BUFFER])
+        if VERTEX_ARRAY in deleted:
+            glDeleteVertexArrays(len(deleted[VERTEX_ARRAY]), deleted[VERTEX_ARRAY])
+        if FRAMEBUFFER in deleted:
+            glDeleteFramebuffers(len(deleted[FRAMEBUFFER]), deleted[FRAMEBUFFER])
+        if RENDERBUFFER in deleted:
+            glDeleteRenderbuffers(len(deleted[RENDERBUFFER]), deleted[RENDERBUFFER])
+        if QUERY in deleted:
+            glDeleteQueries(len(deleted[QUERY]), deleted[QUERY])
+        for program in deleted.get(PROGRAM, []):
+            glDeleteProgram(program)
+        return sum(len(names) for names in deleted.values())
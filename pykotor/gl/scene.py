@@ -1,10 +1,14 @@
 from __future__ import annotations
 
+import logging
 import math
+import time
 import traceback
+from concurrent.futures import Future, wait
 from contextlib import suppress
 from copy import copy
-from typing import Dict, List, Any, Optional, Union, Callable
+from itertools import groupby
+from typing import Dict, List, Any, Optional, Union, Callable, Set, Tuple
 
 import glm
 from OpenGL.GL import glReadPixels
@@ -12,7 +16,8 @@ from OpenGL.raw.GL.ARB.vertex_shader import GL_FLOAT
 from OpenGL.raw.GL.VERSION.GL_1_0 import glEnable, GL_TEXTURE_2D, GL_DEPTH_TEST, glClearColor, glClear, \
     GL_COLOR_BUFFER_BIT, GL_DEPTH_BUFFER_BIT, GL_BLEND, glBlendFunc, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, \
     glDisable, GL_CULL_FACE, GL_BACK, glCullFace, GL_DEPTH_COMPONENT
-from OpenGL.raw.GL.VERSION.GL_1_2 import GL_UNSIGNED_INT_8_8_8_8, GL_BGRA
+from OpenGL.raw.GL.VERSION.GL_1_3 import glActiveTexture, GL_TEXTURE0
+from OpenGL.raw.GL.VERSION.GL_3_0 import glBindFramebuffer, GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER
 from glm import mat4, vec3, quat, vec4
 from pykotor.resource.generics.uti import read_uti
 
@@ -24,17 +29,33 @@ from pykotor.common.stream import BinaryReader
 from pykotor.extract.file import ResourceIdentifier
 from pykotor.extract.installation import Installation, SearchLocation
 from pykotor.resource.formats.lyt import LYT, LYTRoom
-from pykotor.resource.formats.tpc import TPC
+from pykotor.resource.formats.tpc import TPC, read_tpc
 from pykotor.resource.formats.twoda import read_2da, TwoDA
 from pykotor.resource.generics.git import GIT, GITPlaceable, GITCreature, GITDoor, GITTrigger, GITEncounter, \
     GITWaypoint, GITSound, GITStore, GITCamera, GITInstance
 from pykotor.resource.generics.utc import UTC
 from pykotor.resource.type import ResourceType
 
-from pykotor.gl.shader import Shader, KOTOR_VSHADER, KOTOR_FSHADER, Texture, PICKER_FSHADER, PICKER_VSHADER, \
-    PLAIN_VSHADER, PLAIN_FSHADER
-from pykotor.gl.models.read_mdl import gl_load_stitched_model
-from pykotor.gl.models.mdl import Model, Cube, Boundary, Empty
+from pykotor.gl.assets import AssetContext, SharedAsset
+from pykotor.gl.buffer import UniformStream, PixelUploadRing
+from pykotor.gl.creatures import CreatureAssembly, InstallationCache, assembly_key
+from pykotor.gl.eviction import evict, vram_usage
+from pykotor.gl.framebuffer import Framebuffer, framebuffer_bindings
+from pykotor.gl.model_cache import ModelCache
+from pykotor.gl.picking import PickBuffer, DepthSnapshot
+from pykotor.gl.prefetch import ModulePrefetch
+from pykotor.gl.resource_index import ResourceIndex
+from pykotor.gl.resources import TEXTURE
+from pykotor.gl.spatial import LooseOctree
+from pykotor.gl.stats import RenderStats
+from pykotor.gl.texture_array import TextureArrayManager
+from pykotor.gl.texture_loader import TextureLoader
+from pykotor.gl.texture_stream import TextureStreamer
+from pykotor.gl.transcode import TextureTranscoder
+from pykotor.gl.visibility import RoomVisibility
+from pykotor.gl.shader import Shader, Texture
+from pykotor.gl.models.read_mdl import StitchedModelData, parse_stitched_model, build_stitched_model
+from pykotor.gl.models.mdl import Model, Node, Mesh, Cube, Boundary, Empty
 from pykotor.gl.models.predefined_mdl import STORE_MDL_DATA, STORE_MDX_DATA, WAYPOINT_MDL_DATA, WAYPOINT_MDX_DATA, \
     SOUND_MDL_DATA, SOUND_MDX_DATA, CAMERA_MDL_DATA, CAMERA_MDX_DATA, TRIGGER_MDL_DATA, TRIGGER_MDX_DATA, \
     ENCOUNTER_MDL_DATA, ENCOUNTER_MDX_DATA, ENTRY_MDL_DATA, ENTRY_MDX_DATA, EMPTY_MDL_DATA, EMPTY_MDX_DATA, \
@@ -43,35 +64,134 @@ from pykotor.tools import creature
 
 SEARCH_ORDER_2DA = [SearchLocation.OVERRIDE, SearchLocation.CHITIN]
 SEARCH_ORDER = [SearchLocation.CUSTOM_MODULES, SearchLocation.OVERRIDE, SearchLocation.CHITIN]
+TEXTURE_SEARCH_ORDER = [SearchLocation.CUSTOM_MODULES, SearchLocation.OVERRIDE, SearchLocation.TEXTURES_TPA,
+                        SearchLocation.CHITIN]
+# Models drawn for instances and tools, which are never looked up in the installation
+PREDEFINED_MODELS = {
+    "waypoint": (WAYPOINT_MDL_DATA, WAYPOINT_MDX_DATA),
+    "sound": (SOUND_MDL_DATA, SOUND_MDX_DATA),
+    "store": (STORE_MDL_DATA, STORE_MDX_DATA),
+    "entry": (ENTRY_MDL_DATA, ENTRY_MDX_DATA),
+    "encounter": (ENCOUNTER_MDL_DATA, ENCOUNTER_MDX_DATA),
+    "trigger": (TRIGGER_MDL_DATA, TRIGGER_MDX_DATA),
+    "camera": (CAMERA_MDL_DATA, CAMERA_MDX_DATA),
+    "empty": (EMPTY_MDL_DATA, EMPTY_MDX_DATA),
+    "cursor": (CURSOR_MDL_DATA, CURSOR_MDX_DATA),
+    "unknown": (UNKNOWN_MDL_DATA, UNKNOWN_MDX_DATA)
+}
+
+logger = logging.getLogger(__name__)
 
 
 class Scene:
     SPECIAL_MODELS = ["waypoint", "store", "sound", "camera", "trigger", "encounter", "unknown"]
-
-    def __init__(self, *, installation: Optional[Installation] = None, module: Optional[Module] = None):
+    # Maps the data type of a render object to its category; each category can be hidden with a hide_<category> flag
+    CATEGORIES = {LYTRoom: "rooms", GITCreature: "creatures", GITPlaceable: "placeables", GITDoor: "doors",
+                  GITTrigger: "triggers", GITEncounter: "encounters", GITWaypoint: "waypoints", GITSound: "sounds",
+                  GITStore: "stores", GITCamera: "cameras"}
+
+    def __init__(self, *, installation: Optional[Installation] = None, module: Optional[Module] = None,
+                 texture_arrays: bool = False, texture_streaming: bool = False, texture_workers: int = 0,
+                 transcode_textures: bool = False, index_resources: bool = True,
+                 assets: Optional[AssetContext] = None):
+        """
+        Scenes given the same AssetContext share textures and models, so their GL contexts must share objects.
+        """
         glEnable(GL_TEXTURE_2D)
         glEnable(GL_DEPTH_TEST)
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
         glCullFace(GL_BACK)
 
+        self.assets: AssetContext = assets if assets is not None else AssetContext()
+        self.assets.attach(self)
         self.installation: Optional[Installation] = installation
+        # Where models and textures are found, built with the installation and pointed at the capsules of each module
+        self.resource_index: Optional[ResourceIndex] = None
+        self._index_resources: bool = index_resources
+        self._indexed_module: Optional[Module] = None
         self.textures: CaseInsensitiveDict[Texture] = CaseInsensitiveDict()
+        if texture_arrays and self.assets.texture_arrays is None:
+            self.assets.texture_arrays = TextureArrayManager(self.assets.resources)
+        self.texture_arrays: Optional[TextureArrayManager] = self.assets.texture_arrays if texture_arrays else None
+        self.texture_streamer: Optional[TextureStreamer] = TextureStreamer() if texture_streaming else None
+        self.transcoder: Optional[TextureTranscoder] = TextureTranscoder() if transcode_textures else None
+        # Keeps parsed models on disk when set, so they are not parsed again by other scenes, processes and runs
+        self.model_cache: Optional[ModelCache] = None
+        self._bound_textures: Dict[int, int] = {}
+        self.texture_loader: TextureLoader = TextureLoader(self.assets.pending_textures, texture_workers)
+        # Models parsed ahead of use by prefetchModule(), keyed by lowercase name
+        self._pending_models: Dict[str, Future] = {}
+        self._prefetch: Optional[ModulePrefetch] = None
+        # Seconds per frame spent uploading textures whose TPC has been loaded by a worker, and as much again on
+        # building prefetched models
+        self.texture_upload_budget: float = 0.004
+        # Bytes of textures and models kept on the GPU before the least recently drawn ones are freed
+        self.vram_budget: int = 1 << 30
+        self._vram_changed: bool = False
+        self._texture_names: Set[str] = set()
+        self._model_names: Set[str] = set()
+        # This scene's share of the textures and models in the asset context, keyed by lowercase name
+        self._texture_assets: Dict[str, SharedAsset[Texture]] = {}
+        self._model_assets: Dict[str, SharedAsset[Model]] = {}
+        self._frame: int = 0
+        # Timings and counters of recent frames; set stats.enabled to False to stop recording them
+        self.stats: RenderStats = RenderStats(self.assets.resources, self)
+        self._shader: Optional[Shader] = None
         self.models: CaseInsensitiveDict[Model] = CaseInsensitiveDict()
         self.objects: Dict[Any, RenderObject] = {}
+        self.spatial: LooseOctree[RenderObject] = LooseOctree(self._object_bounds)
+        self.visibility: RoomVisibility = RoomVisibility(self.spatial)
+        # Objects indexed with a box around their position because a model of theirs was still being prefetched
+        self._provisional: Dict[RenderObject, None] = {}
+        # Creatures created before the prefetch built their body or head, with the assembly key and the models they
+        # are assembled from
+        self._unassembled: Dict[RenderObject, Tuple[Tuple, Tuple[Optional[str], ...]]] = {}
+        self._residency_changed: bool = False
+        self._categories: Dict[str, Dict[RenderObject, None]] = {}
+        self._main_objects: List[RenderObject] = []
+        self._special_objects: List[RenderObject] = []
+        self._render_lists_changed: bool = True
+        self._hidden_state: Tuple[bool, ...] = ()
+        self._model_generation: int = 0
+        # Stable IDs of the render objects for picking; 0 means no object
+        self._object_ids: Dict[RenderObject, int] = {}
+        self._id_objects: Dict[int, RenderObject] = {}
+        self._next_object_id: int = 1
+        self.pick_buffer: Optional[PickBuffer] = None
+        # Answer pick(), hoverPick() and screenToWorld() with raycast() instead of rendering and reading back
+        self.cpu_picking: bool = False
+        self._hovered: Optional[RenderObject] = None
+        self._clear_categories()
         self.selection: List[RenderObject] = []
         self.module: Optional[Module] = module
         self.camera: Camera = Camera()
         self.cursor: RenderObject = RenderObject("cursor")
 
-        self.textures["NULL"] = Texture.from_color()
+        self.textures["NULL"] = self.assets.null_texture
 
         self.git: Optional[GIT] = None
         self.layout: Optional[LYT] = None
         self.clearCacheBuffer: List[ResourceIdentifier] = []
-
-        self.picker_shader: Shader = Shader(PICKER_VSHADER, PICKER_FSHADER)
-        self.plain_shader: Shader = Shader(PLAIN_VSHADER, PLAIN_FSHADER)
-        self.shader: Shader = Shader(KOTOR_VSHADER, KOTOR_FSHADER)
+        self._git_changed: bool = True
+        self._layout_changed: bool = True
+        # What buildCache() last saw of each GIT instance when git_polling is on
+        self._git_fingerprints: Dict[GITInstance, Tuple] = {}
+
+        self.picker_shader: Shader = self.assets.picker_shader
+        self.plain_shader: Shader = self.assets.plain_shader
+        self.shader: Shader = self.assets.shader
+        self.uniforms: UniformStream = UniformStream(self.assets.resources)
+        self.pixel_uploads: PixelUploadRing = PixelUploadRing(self.assets.resources)
+        # Offscreen target to render into, released with the scene; if None the scene renders into whatever
+        # framebuffer is bound
+        self.framebuffer: Optional[Framebuffer] = None
+        # Where screenToWorld() renders the rooms when no depth snapshot is available yet
+        self._depth_target: Optional[Framebuffer] = None
+        # Resolved creature models keyed by assembly_key(), and the item lookups made while resolving them
+        self._creature_assemblies: Dict[Tuple, CreatureAssembly] = {}
+        self._installation_cache: Optional[InstallationCache] = None
+        # Depth of the rooms from the last frame read back, which screenToWorld() unprojects instead of rendering
+        self.depth_snapshot: Optional[DepthSnapshot] = None
 
         self.jumpToEntryLocation()
 
@@ -98,6 +218,13 @@ class Scene:
         self.backface_culling: bool = True
         self.use_lightmap: bool = True
         self.show_cursor: bool = True
+        self.vis_culling: bool = True
+        self.frustum_culling: bool = True
+        # Copies of a mesh drawn with the same textures in one frame are drawn with one instanced call
+        self.instancing: bool = True
+        # Compares every GIT instance with what was last seen on each buildCache(), for code that edits the GIT in
+        # place without reporting the edits through addInstance(), removeInstance() or updateInstance()
+        self.git_polling: bool = False
 
     def setInstallation(self, installation: Installation) -> None:
         self.table_doors = read_2da(installation.resource("genericdoors", ResourceType.TwoDA, SEARCH_ORDER_2DA).data)
@@ -105,222 +232,621 @@ class Scene:
         self.table_creatures = read_2da(installation.resource("appearance", ResourceType.TwoDA, SEARCH_ORDER_2DA).data)
         self.table_heads = read_2da(installation.resource("heads", ResourceType.TwoDA, SEARCH_ORDER_2DA).data)
         self.table_baseitems = read_2da(installation.resource("baseitems", ResourceType.TwoDA, SEARCH_ORDER_2DA).data)
+        self._creature_assemblies.clear()
+        self.installation = installation
+        if self._index_resources:
+            # Reads every archive of the installation when nothing is saved yet, so it is built here, not while drawing
+            self.resource_index = ResourceIndex(installation)
+            self._indexed_module = None
 
     def getCreatureRenderObject(self, instance: GITCreature, utc: Optional[UTC] = None) -> RenderObject:
+        key = None
         try:
             if utc is None:
                 utc = self.module.creature(instance.resref.get()).resource()
 
-            head_obj = None
-            mask_hook = None
-
-            body_model, body_texture = creature.get_body_model(
-                utc, self.installation, appearance=self.table_creatures, baseitems=self.table_baseitems
-            )
-            head_model, head_texture = creature.get_head_model(
-                utc, self.installation, appearance=self.table_creatures, heads=self.table_heads
-            )
-            rhand_model, lhand_model = creature.get_weapon_models(
-                utc, self.installation, appearance=self.table_creatures, baseitems=self.table_baseitems
-            )
-            mask_model = creature.get_mask_model(
-                utc, self.installation
-            )
-
-            obj = RenderObject(body_model, data=instance, override_texture=body_texture)
-
-            head_hook = self.model(body_model).find("headhook")
-            if head_model and head_hook:
-                head_obj = RenderObject(head_model, override_texture=head_texture)
-                head_obj.set_transform(head_hook.global_transform())
-                obj.children.append(head_obj)
-
-            rhand_hook = self.model(body_model).find("rhand")
-            if rhand_model and rhand_hook:
-                rhand_obj = RenderObject(rhand_model)
-                rhand_obj.set_transform(rhand_hook.global_transform())
-                obj.children.append(rhand_obj)
-
-            lhand_hook = self.model(body_model).find("lhand")
-            if lhand_model and lhand_hook:
-                lhand_obj = RenderObject(lhand_model)
-                lhand_obj.set_transform(lhand_hook.global_transform())
-                obj.children.append(lhand_obj)
-
-            if head_hook is None:
-                mask_hook = self.model(body_model).find("gogglehook")
-            elif head_model:
-                mask_hook = self.model(head_model).find("gogglehook")
-            if mask_model and mask_hook:
-                mask_obj = RenderObject(mask_model)
-                mask_obj.set_transform(mask_hook.global_transform())
-                if head_hook is None:
-                    obj.children.append(mask_obj)
-                elif head_obj is not None:
-                    head_obj.children.append(mask_obj)
-
-        except Exception as e:
-            print(e)
+            installation = self._creature_installation()
+            key = assembly_key(utc, installation)
+            assembly = self._creature_assemblies.get(key)
+            if assembly is None:
+                models = self._creature_models(utc, installation)
+                if self._awaiting_assembly(models):
+                    # The hooks are read from the body and head, so the parts are added once the prefetch built them
+                    obj = RenderObject(models[0], data=instance, override_texture=models[1])
+                    self._unassembled[obj] = (key, models)
+                    return obj
+                assembly = self._creature_assemblies[key] = self._assemble_creature(*models)
+
+            obj = RenderObject(assembly.body_model, data=instance, override_texture=assembly.body_texture)
+            self._dress_creature(obj, assembly)
+
+        except Exception:
+            logger.exception("Could not load the models of creature %s (assembly %s)", instance.resref, key)
             # If failed to load creature models, use the unknown model instead
             obj = RenderObject("unknown", data=instance)
 
         return obj
 
+    def _dress_creature(self, obj: RenderObject, assembly: CreatureAssembly) -> None:
+        head_obj = None
+        if assembly.head is not None:
+            head_model, head_texture, transform = assembly.head
+            head_obj = RenderObject(head_model, override_texture=head_texture)
+            head_obj.set_transform(mat4(transform))
+            obj.children.append(head_obj)
+
+        for hand_model, transform in assembly.hands:
+            hand_obj = RenderObject(hand_model)
+            hand_obj.set_transform(mat4(transform))
+            obj.children.append(hand_obj)
+
+        if assembly.mask is not None:
+            mask_model, transform = assembly.mask
+            mask_obj = RenderObject(mask_model)
+            mask_obj.set_transform(mat4(transform))
+            (head_obj if assembly.mask_on_head else obj).children.append(mask_obj)
+
+    def _awaiting_assembly(self, models: Tuple[Optional[str], ...]) -> bool:
+        body_model, head_model = models[0], models[2]
+        return self._awaiting(body_model) or bool(head_model) and self._awaiting(head_model)
+
+    def _creature_installation(self) -> Optional[InstallationCache]:
+        if self._installation_cache is None or self._installation_cache.installation is not self.installation:
+            self._installation_cache = InstallationCache(self.installation) if self.installation is not None else None
+        return self._installation_cache
+
+    def _assemble_creature(self, body_model: str, body_texture: Optional[str], head_model: Optional[str],
+                           head_texture: Optional[str], rhand_model: Optional[str], lhand_model: Optional[str],
+                           mask_model: Optional[str]) -> CreatureAssembly:
+        assembly = CreatureAssembly(body_model, body_texture)
+        body = self.model(body_model)
+
+        head_hook = body.find("headhook")
+        if head_model and head_hook:
+            assembly.head = (head_model, head_texture, head_hook.global_transform())
+
+        for hand_model, hook_name in ((rhand_model, "rhand"), (lhand_model, "lhand")):
+            hand_hook = body.find(hook_name)
+            if hand_model and hand_hook:
+                assembly.hands.append((hand_model, hand_hook.global_transform()))
+
+        mask_hook = None
+        if head_hook is None:
+            mask_hook = body.find("gogglehook")
+        elif head_model:
+            mask_hook = self.model(head_model).find("gogglehook")
+        if mask_model and mask_hook:
+            assembly.mask = (mask_model, mask_hook.global_transform())
+            assembly.mask_on_head = head_hook is not None
+
+        return assembly
+
+    def _creature_models(self, utc: UTC, installation: Any) -> Tuple[str, Optional[str], Optional[str], Optional[str],
+                                                                      Optional[str], Optional[str], Optional[str]]:
+        """
+        Returns the body, head, hand and mask models and textures of a creature without touching GL state.
+        """
+        body_model, body_texture = creature.get_body_model(
+            utc, installation, appearance=self.table_creatures, baseitems=self.table_baseitems
+        )
+        head_model, head_texture = creature.get_head_model(
+            utc, installation, appearance=self.table_creatures, heads=self.table_heads
+        )
+        rhand_model, lhand_model = creature.get_weapon_models(
+            utc, installation, appearance=self.table_creatures, baseitems=self.table_baseitems
+        )
+        mask_model = creature.get_mask_model(
+            utc, installation
+        )
+        return body_model, body_texture, head_model, head_texture, rhand_model, lhand_model, mask_model
+
     def buildCache(self, clearCache: bool = False) -> None:
+        """
+        Brings the render objects in line with the module; GIT edits only show up when reported through addInstance(),
+        removeInstance(), updateInstance() or invalidateGit(), or with git_polling on.
+        """
         if self.module is None:
             return
 
         if clearCache:
+            self._release_objects()
             self.objects = {}
+            self.spatial.clear()
+            self._provisional = {}
+            self._unassembled = {}
+            self._clear_categories()
+            self._git_changed = True
+            self._layout_changed = True
+            self._git_fingerprints = {}
+            self._creature_assemblies.clear()
+            if self._installation_cache is not None:
+                self._installation_cache.clear()
 
         for identifier in self.clearCacheBuffer:
-            for creature in copy(self.git.creatures):
+            for creature in self.git.creatures:
                 if identifier.resname == creature.resref and identifier.restype == ResourceType.UTC:
-                    del self.objects[creature]
-            for placeable in copy(self.git.placeables):
+                    self.removeInstance(creature)
+            for placeable in self.git.placeables:
                 if identifier.resname == placeable.resref and identifier.restype == ResourceType.UTP:
-                    del self.objects[placeable]
-            for door in copy(self.git.doors):
+                    self.removeInstance(placeable)
+            for door in self.git.doors:
                 if door.resref.get() == identifier.resname and identifier.restype == ResourceType.UTD:
-                    del self.objects[door]
-            if identifier.restype in [ResourceType.TPC, ResourceType.TGA]:
-                del self.textures[identifier.resname]
+                    self.removeInstance(door)
+            if identifier.restype in [ResourceType.TPC, ResourceType.TGA] and identifier.resname in self.textures:
+                self._request_texture(identifier.resname)
+            if identifier.restype in [ResourceType.UTI, ResourceType.MDL, ResourceType.MDX]:
+                # Item edits change what creatures wear and model edits can move the hooks they wear it on
+                self._creature_assemblies.clear()
+                if identifier.restype == ResourceType.UTI and self._installation_cache is not None:
+                    self._installation_cache.forget(identifier.resname, identifier.restype)
             if identifier.restype in [ResourceType.MDL, ResourceType.MDX]:
-                del self.models[identifier.resname]
+                self._pending_models.pop(identifier.resname.lower(), None)
+            if identifier.restype in [ResourceType.MDL, ResourceType.MDX] and identifier.resname in self.models:
+                # Other scenes keep drawing the old model until they reload it themselves
+                self.assets.forget(self._model_assets[identifier.resname.lower()])
+                self._drop_model(identifier.resname)
             if identifier.restype in [ResourceType.GIT]:
-                for instance in self.git.instances():
-                    del self.objects[instance]
                 self.git = self.module.git().resource()
             if identifier.restype in [ResourceType.LYT]:
-                for room in self.layout.rooms:
-                    del self.objects[room]
                 self.layout = self.module.layout().resource()
+                self._layout_changed = True
+            if identifier.restype in [ResourceType.VIS]:
+                self.visibility.unload()
+            if identifier.restype in [ResourceType.GIT, ResourceType.UTC, ResourceType.UTP, ResourceType.UTD]:
+                self._git_changed = True
         self.clearCacheBuffer = []
 
         if self.git is None:
             self.git = self.module.git().resource()
+            self._git_changed = True
 
         if self.layout is None:
             self.layout = self.module.layout().resource()
+            self._layout_changed = True
+
+        if not self.visibility.loaded():
+            vis = None
+            with suppress(Exception):
+                vis = self.module.vis().resource()
+            self.visibility.load(vis)
+
+        if self._layout_changed:
+            self._diff_layout()
+        if self._git_changed:
+            self._diff_git()
+        if self.git_polling:
+            self._poll_git()
+
+    def _index_module(self) -> None:
+        if self.resource_index is not None and self._indexed_module is not self.module:
+            self.resource_index.set_capsules(self.module.capsules() if self.module is not None else [])
+            self._indexed_module = self.module
+
+    def refreshResources(self) -> bool:
+        """
+        Rescans the override folder for added or removed files and returns whether there were any.
+        """
+        return self.resource_index is not None and self.resource_index.refresh(force=True)
+
+    def setModule(self, module: Optional[Module], progress: Optional[Callable[[int, int], None]] = None) -> None:
+        """
+        Switches to another module, keeping loaded textures and models cached and prefetching the rest in the
+        background.
+        """
+        self.module = module
+        self.git = None
+        self.layout = None
+        self.visibility.unload()
+        self.selection.clear()
+        self._release_objects()
+        self.objects = {}
+        self.spatial.clear()
+        self._provisional = {}
+        self._unassembled = {}
+        self._clear_categories()
+        self._index_module()
+        self.prefetchModule(progress)
+        self.buildCache(clearCache=True)
+        self.jumpToEntryLocation()
 
-        for room in self.layout.rooms:
-            if room not in self.objects:
-                position = vec3(room.position.x, room.position.y, room.position.z)
-                self.objects[room] = RenderObject(room.model, position, data=room)
-
-        for door in self.git.doors:
-            if door not in self.objects:
-                try:
-                    utd = self.module.door(door.resref.get()).resource()
-                    model_name = self.table_doors.get_row(utd.appearance_id).get_string("modelname")
-                except Exception:
-                    # If failed to load creature models, use an empty model instead
-                    model_name = "unknown"
-
-                self.objects[door] = RenderObject(model_name, vec3(), vec3(), data=door)
-
-            self.objects[door].set_position(door.position.x, door.position.y, door.position.z)
-            self.objects[door].set_rotation(0, 0, door.bearing)
-
-        for placeable in self.git.placeables:
-            if placeable not in self.objects:
-                try:
-                    utp = self.module.placeable(placeable.resref.get()).resource()
-                    model_name = self.table_placeables.get_row(utp.appearance_id).get_string("modelname")
-                except Exception:
-                    # If failed to load creature models, use an empty model instead
-                    model_name = "unknown"
-
-                self.objects[placeable] = RenderObject(model_name, vec3(), vec3(), data=placeable)
-
-            self.objects[placeable].set_position(placeable.position.x, placeable.position.y, placeable.position.z)
-            self.objects[placeable].set_rotation(0, 0, placeable.bearing)
-
-        for creature in self.git.creatures:
-            if creature not in self.objects:
-                self.objects[creature] = self.getCreatureRenderObject(creature)
+    def prefetchModule(self, progress: Optional[Callable[[int, int], None]] = None) -> None:
+        """
+        Starts loading the models and textures the module references on the texture workers, calling progress with the
+        number loaded and found so far.
+        """
+        self._cancel_prefetch()
+        if self.module is None or not self.texture_loader.asynchronous():
+            return
+        self._index_module()
+        self._prefetch = ModulePrefetch(self.texture_loader.submit(self._scan_module, self.module), progress)
+
+    def waitForPrefetch(self) -> None:
+        """
+        Blocks until everything prefetchModule() found has been loaded and uploaded.
+        """
+        while self._prefetch is not None:
+            if self._prefetch.scan is not None:
+                wait([self._prefetch.scan])
+            self._advance_prefetch(block=True)
+            self.waitForTextures()
+        self._settle_objects()
+
+    def _cancel_prefetch(self) -> None:
+        if self._prefetch is not None:
+            self._prefetch.cancel()
+            self._prefetch = None
+            self._residency_changed = True
+        for future in self._pending_models.values():
+            future.cancel()
+        self._pending_models.clear()
+
+    def _scan_module(self, module: Module) -> Tuple[List[str], List[str]]:
+        """
+        Returns the names of the models and textures the module's rooms and instances are drawn with.
+        """
+        models, textures = set(), set()
+        with suppress(Exception):
+            models.update(room.model for room in module.layout().resource().rooms)
+
+        git = module.git().resource()
+        for door in git.doors:
+            with suppress(Exception):
+                utd = module.door(door.resref.get()).resource()
+                models.add(self.table_doors.get_row(utd.appearance_id).get_string("modelname"))
+        for placeable in git.placeables:
+            with suppress(Exception):
+                utp = module.placeable(placeable.resref.get()).resource()
+                models.add(self.table_placeables.get_row(utp.appearance_id).get_string("modelname"))
+        for git_creature in git.creatures:
+            with suppress(Exception):
+                utc = module.creature(git_creature.resref.get()).resource()
+                body_model, body_texture, head_model, head_texture, *equipment = \
+                    self._creature_models(utc, self.installation)
+                models.update((body_model, head_model, *equipment))
+                textures.update((body_texture, head_texture))
+
+        return [name for name in models if name and name not in self.SPECIAL_MODELS], \
+            [name for name in textures if name]
+
+    def _advance_prefetch(self, block: bool = False) -> None:
+        """
+        Builds the models the prefetch has parsed, within texture_upload_budget unless blocking, and reports progress.
+        """
+        prefetch = self._prefetch
+        if prefetch is None:
+            return
 
-            self.objects[creature].set_position(creature.position.x, creature.position.y, creature.position.z)
-            self.objects[creature].set_rotation(0, 0, creature.bearing)
+        if prefetch.scan is not None and prefetch.scan.done():
+            models, textures = prefetch.scan.result() if prefetch.scan.exception() is None else ([], [])
+            prefetch.scan = None
+            # Models the scan did not find are no longer waited for
+            self._residency_changed = True
+            for name in models:
+                prefetch.models.add(name.lower())
+                if name not in self.models and name.lower() not in self._pending_models \
+                        and self._model_key(name) not in self.assets:
+                    self._pending_models[name.lower()] = self.texture_loader.submit(self._parse_model, name)
+            for name in textures:
+                self._prefetch_texture(prefetch, name)
+
+        deadline = time.perf_counter() + self.texture_upload_budget
+        for name in prefetch.models - prefetch.built:
+            future = self._pending_models.get(name)
+            if not block and (time.perf_counter() > deadline or future is not None and not future.done()):
+                continue
+            # Models that were already resident, or shared by another scene, need their textures loaded just the same
+            for texture in self.model(name).textures():
+                self._prefetch_texture(prefetch, texture)
+            prefetch.built.add(name)
+
+        pending = self.texture_loader.pending
+        textures_loaded = sum(1 for name in prefetch.textures if self.textures[name] not in pending)
+        if prefetch.report(textures_loaded):
+            self._prefetch = None
+            self._residency_changed = True
+
+    def _prefetch_texture(self, prefetch: ModulePrefetch, name: str) -> None:
+        prefetch.textures.add(name.lower())
+        if name not in self.textures:
+            self.texture(name)
 
-        for waypoint in self.git.waypoints:
-            if waypoint not in self.objects:
-                obj = RenderObject("waypoint", vec3(), vec3(), data=waypoint)
-                self.objects[waypoint] = obj
+    def invalidateGit(self) -> None:
+        """
+        Makes the next buildCache() diff every GIT instance against the render objects, for bulk edits.
+        """
+        self._git_changed = True
 
-            self.objects[waypoint].set_position(waypoint.position.x, waypoint.position.y, waypoint.position.z)
-            self.objects[waypoint].set_rotation(0, 0, waypoint.bearing)
+    def addInstance(self, instance: GITInstance) -> None:
+        if instance in self.objects:
+            self._sync_object(instance)
+        else:
+            self.objects[instance] = self._create_object(instance)
+            self._sync_object(instance)
+            self._add_object(self.objects[instance])
+
+    def removeInstance(self, instance: GITInstance) -> None:
+        obj = self.objects.pop(instance, None)
+        self._remove_object(obj)
+        self.visibility.forget(obj)
+        if obj is not None and obj in self.selection:
+            self.selection.remove(obj)
+
+    def updateInstance(self, instance: GITInstance) -> None:
+        if instance in self.objects:
+            self._sync_object(instance)
+        else:
+            self.addInstance(instance)
 
-        for store in self.git.stores:
-            if store not in self.objects:
-                obj = RenderObject("store", vec3(), vec3(), data=store)
-                self.objects[store] = obj
+    def _git_instances(self) -> List[GITInstance]:
+        return [*self.git.doors, *self.git.placeables, *self.git.creatures, *self.git.waypoints, *self.git.stores,
+                *self.git.sounds, *self.git.encounters, *self.git.triggers, *self.git.cameras]
 
-            self.objects[store].set_position(store.position.x, store.position.y, store.position.z)
-            self.objects[store].set_rotation(0, 0, store.bearing)
+    def _diff_layout(self) -> None:
+        self.visibility.forget_all()
 
-        for sound in self.git.sounds:
-            if sound not in self.objects:
-                with suppress(Exception):
-                    uts = self.module.sound(sound.resref.get()).resource()
-                    genBoundary = lambda boundary=Boundary.from_circle(self, uts.max_distance): boundary
+        rooms = set(self.layout.rooms)
+        for room in [key for key in self.objects if isinstance(key, LYTRoom) and key not in rooms]:
+            self._remove_object(self.objects.pop(room))
 
-                obj = RenderObject("sound", vec3(), vec3(), data=sound, genBoundary=genBoundary)
-                self.objects[sound] = obj
+        for room in self.layout.rooms:
+            if room not in self.objects:
+                position = vec3(room.position.x, room.position.y, room.position.z)
+                self.objects[room] = RenderObject(room.model, position, data=room)
+                self._add_object(self.objects[room])
+        self._layout_changed = False
+
+    def _awaiting(self, name: str) -> bool:
+        """
+        Returns whether the running prefetch will build the model, so nothing else should load it.
+        """
+        prefetch = self._prefetch
+        return prefetch is not None and name not in self.models and name.lower() not in PREDEFINED_MODELS \
+            and (prefetch.scan is not None or name.lower() in self._pending_models)
+
+    def _prefetching(self, obj: RenderObject) -> bool:
+        return any(self._awaiting(name) for name in obj.models())
+
+    def _object_bounds(self, obj: RenderObject) -> Tuple[vec3, vec3]:
+        """
+        Returns the bounds the spatial index holds the object with, a unit box around it until its models are resident.
+        """
+        if self._prefetching(obj):
+            self._provisional[obj] = None
+            position = obj.position()
+            return position - vec3(0.5), position + vec3(0.5)
+        return obj.world_bounds(self)
+
+    def _settle_objects(self) -> None:
+        """
+        Finishes the creatures and bounds that were waiting for prefetched models.
+        """
+        if not self._provisional and not self._unassembled or not self._residency_changed:
+            return
+        self._residency_changed = False
 
-            self.objects[sound].set_position(sound.position.x, sound.position.y, sound.position.z)
-            self.objects[sound].set_rotation(0, 0, 0)
+        for obj, (key, models) in list(self._unassembled.items()):
+            if self._awaiting_assembly(models):
+                continue
+            del self._unassembled[obj]
+            try:
+                if key not in self._creature_assemblies:
+                    self._creature_assemblies[key] = self._assemble_creature(*models)
+                self._dress_creature(obj, self._creature_assemblies[key])
+            except Exception:
+                logger.exception("Could not load the models of creature %s (assembly %s)", obj.data.resref, key)
+                # Drawn with the unknown model instead, as getCreatureRenderObject() does
+                obj.model, obj.override_texture, obj.children = "unknown", None, []
+                obj._override, obj._model_generation = None, -1
+            obj.reset_cube()
+
+        settled = [obj for obj in self._provisional if not self._prefetching(obj)]
+        for obj in settled:
+            del self._provisional[obj]
+            obj.reset_cube()
+        if any(isinstance(obj.data, LYTRoom) for obj in settled):
+            # Instances were placed in rooms by the stand-in bounds
+            self.visibility.forget_all()
+
+    def _add_object(self, obj: RenderObject) -> None:
+        self.spatial.insert(obj)
+        obj._spatial = self.spatial
+        if obj not in self._object_ids:
+            self._object_ids[obj] = self._next_object_id
+            self._id_objects[self._next_object_id] = obj
+            self._next_object_id += 1
+        self._categories[self.CATEGORIES.get(type(obj.data), "other")][obj] = None
+        self._render_lists_changed = True
+
+    def _remove_object(self, obj: Optional[RenderObject]) -> None:
+        if obj is not None:
+            obj.release()
+            self.spatial.remove(obj)
+            self._provisional.pop(obj, None)
+            self._unassembled.pop(obj, None)
+            obj._spatial = None
+            self._id_objects.pop(self._object_ids.pop(obj, 0), None)
+            if self._hovered is obj:
+                self._hovered = None
+            self._categories[self.CATEGORIES.get(type(obj.data), "other")].pop(obj, None)
+            self._render_lists_changed = True
+
+    def _release_objects(self) -> None:
+        for obj in self.objects.values():
+            obj.release()
+
+    def _clear_categories(self) -> None:
+        self._categories = {category: {} for category in self.CATEGORIES.values()}
+        self._categories["other"] = {}
+        self._render_lists_changed = True
+        self._object_ids = {}
+        self._id_objects = {}
+
+    def _update_render_lists(self) -> None:
+        """
+        Rebuilds the object lists of the passes after objects or hide flags changed.
+        """
+        hidden = tuple(getattr(self, "hide_" + category, False) for category in self._categories)
+        if not self._render_lists_changed and hidden == self._hidden_state:
+            return
 
-        for encounter in self.git.encounters:
-            if encounter not in self.objects:
-                genBoundary = lambda boundary=Boundary(self, encounter.geometry.points): boundary
-                obj = RenderObject("encounter", vec3(), vec3(), data=encounter, genBoundary=genBoundary)
-                self.objects[encounter] = obj
+        self._main_objects = []
+        self._special_objects = []
+        for hide, objects in zip(hidden, self._categories.values()):
+            if not hide:
+                for obj in objects:
+                    if obj.model in self.SPECIAL_MODELS:
+                        self._special_objects.append(obj)
+                    else:
+                        self._main_objects.append(obj)
+
+        self._hidden_state = hidden
+        self._render_lists_changed = False
+
+    def _resolve_model(self, obj: RenderObject) -> Model:
+        if obj._model_generation != self._model_generation and self._awaiting(obj.model):
+            # Drawn as nothing until the prefetch has built it, rather than parsed on the main thread
+            return self.model("empty")
+        if obj._model_generation != self._model_generation:
+            obj._model = self.model(obj.model)
+            obj._model_generation = self._model_generation
+        obj._model.last_used = self._frame
+        return obj._model
+
+    def _diff_git(self) -> None:
+        instances = self._git_instances()
 
-            self.objects[encounter].set_position(encounter.position.x, encounter.position.y, encounter.position.z)
-            self.objects[encounter].set_rotation(0, 0, 0)
+        # Detect if GIT still exists; if they do not then remove them from the render list
+        live = set(instances)
+        for instance in [key for key in self.objects if isinstance(key, GITInstance) and key not in live]:
+            self.removeInstance(instance)
+
+        for instance in instances:
+            self.addInstance(instance)
+        self._git_changed = False
+
+    def _poll_git(self) -> None:
+        fingerprints = {instance: self._fingerprint(instance) for instance in self._git_instances()}
+        for instance in [key for key in self._git_fingerprints if key not in fingerprints]:
+            self.removeInstance(instance)
+        for instance, fingerprint in fingerprints.items():
+            previous = self._git_fingerprints.get(instance)
+            if previous is None or instance not in self.objects:
+                self.addInstance(instance)
+            elif previous[0] != fingerprint[0]:
+                # Another blueprint can mean another model, so the object is created again
+                self.removeInstance(instance)
+                self.addInstance(instance)
+            elif previous != fingerprint:
+                self.updateInstance(instance)
+        self._git_fingerprints = fingerprints
+
+    @staticmethod
+    def _fingerprint(instance: GITInstance) -> Tuple:
+        position = instance.position
+        if isinstance(instance, GITCamera):
+            rotation = (instance.orientation.x, instance.orientation.y, instance.orientation.z,
+                        instance.orientation.w, instance.pitch, instance.height)
+        else:
+            rotation = getattr(instance, "bearing", None)
+        return str(getattr(instance, "resref", "")).lower(), position.x, position.y, position.z, rotation
 
-        for trigger in self.git.triggers:
-            if trigger not in self.objects:
-                genBoundary = lambda boundary=Boundary(self, trigger.geometry.points): boundary
-                obj = RenderObject("trigger", vec3(), vec3(), data=trigger, genBoundary=genBoundary)
-                self.objects[trigger] = obj
+    def _create_object(self, instance: GITInstance) -> RenderObject:
+        if isinstance(instance, GITDoor):
+            try:
+                utd = self.module.door(instance.resref.get()).resource()
+                model_name = self.table_doors.get_row(utd.appearance_id).get_string("modelname")
+            except Exception:
+                # If failed to load creature models, use an empty model instead
+                model_name = "unknown"
+            return RenderObject(model_name, vec3(), vec3(), data=instance)
 
-            self.objects[trigger].set_position(trigger.position.x, trigger.position.y, trigger.position.z)
-            self.objects[trigger].set_rotation(0, 0, 0)
+        if isinstance(instance, GITPlaceable):
+            try:
+                utp = self.module.placeable(instance.resref.get()).resource()
+                model_name = self.table_placeables.get_row(utp.appearance_id).get_string("modelname")
+            except Exception:
+                # If failed to load creature models, use an empty model instead
+                model_name = "unknown"
+            return RenderObject(model_name, vec3(), vec3(), data=instance)
+
+        if isinstance(instance, GITCreature):
+            return self.getCreatureRenderObject(instance)
+
+        if isinstance(instance, GITWaypoint):
+            return RenderObject("waypoint", vec3(), vec3(), data=instance)
+
+        if isinstance(instance, GITStore):
+            return RenderObject("store", vec3(), vec3(), data=instance)
+
+        if isinstance(instance, GITSound):
+            genBoundary = None
+            with suppress(Exception):
+                uts = self.module.sound(instance.resref.get()).resource()
+                genBoundary = lambda radius=uts.max_distance: Boundary.from_circle(self, radius)
+            return RenderObject("sound", vec3(), vec3(), data=instance, genBoundary=genBoundary)
+
+        if isinstance(instance, GITEncounter):
+            genBoundary = lambda: Boundary(self, instance.geometry.points)
+            return RenderObject("encounter", vec3(), vec3(), data=instance, genBoundary=genBoundary)
+
+        if isinstance(instance, GITTrigger):
+            genBoundary = lambda: Boundary(self, instance.geometry.points)
+            return RenderObject("trigger", vec3(), vec3(), data=instance, genBoundary=genBoundary)
+
+        if isinstance(instance, GITCamera):
+            return RenderObject("camera", vec3(), vec3(), data=instance)
+
+        return RenderObject("unknown", vec3(), vec3(), data=instance)
+
+    def _sync_object(self, instance: GITInstance) -> None:
+        obj = self.objects[instance]
+        self.visibility.forget(obj)
+
+        if isinstance(instance, GITCamera):
+            obj.set_position(instance.position.x, instance.position.y, instance.position.z+instance.height)
+            euler = glm.eulerAngles(quat(instance.orientation.w, instance.orientation.x, instance.orientation.y,
+                                         instance.orientation.z))
+            obj.set_rotation(euler.y, euler.z-math.pi/2+math.radians(instance.pitch), -euler.x+math.pi/2)
+        elif isinstance(instance, (GITSound, GITEncounter, GITTrigger)):
+            obj.set_position(instance.position.x, instance.position.y, instance.position.z)
+            obj.set_rotation(0, 0, 0)
+        else:
+            obj.set_position(instance.position.x, instance.position.y, instance.position.z)
+            obj.set_rotation(0, 0, instance.bearing)
 
-        for camera in self.git.cameras:
-            if camera not in self.objects:
-                obj = RenderObject("camera", vec3(), vec3(), data=camera)
-                self.objects[camera] = obj
+    def _visible_rooms(self) -> Optional[Set[str]]:
+        if not self.vis_culling or self.layout is None:
+            return None
+        return self.visibility.visible_rooms(self.camera.truePosition())
 
-            self.objects[camera].set_position(camera.position.x, camera.position.y, camera.position.z+camera.height)
-            euler = glm.eulerAngles(quat(camera.orientation.w, camera.orientation.x, camera.orientation.y, camera.orientation.z))
-            self.objects[camera].set_rotation(euler.y, euler.z-math.pi/2+math.radians(camera.pitch), -euler.x+math.pi/2)
+    def _in_frustum(self) -> Optional[Set[RenderObject]]:
+        if not self.frustum_culling:
+            return None
+        return set(self.spatial.query_frustum(self.camera.projection() * self.camera.view()))
 
-        # Detect if GIT still exists; if they do not then remove them from the render list
-        for obj in copy(self.objects):
-            if isinstance(obj, GITCreature) and obj not in self.git.creatures:
-                del self.objects[obj]
-            if isinstance(obj, GITPlaceable) and obj not in self.git.placeables:
-                del self.objects[obj]
-            if isinstance(obj, GITDoor) and obj not in self.git.doors:
-                del self.objects[obj]
-            if isinstance(obj, GITTrigger) and obj not in self.git.triggers:
-                del self.objects[obj]
-            if isinstance(obj, GITStore) and obj not in self.git.stores:
-                del self.objects[obj]
-            if isinstance(obj, GITCamera) and obj not in self.git.cameras:
-                del self.objects[obj]
-            if isinstance(obj, GITWaypoint) and obj not in self.git.waypoints:
-                del self.objects[obj]
-            if isinstance(obj, GITEncounter) and obj not in self.git.encounters:
-                del self.objects[obj]
-            if isinstance(obj, GITSound) and obj not in self.git.sounds:
-                del self.objects[obj]
+    def _culled(self, obj: RenderObject, visible_rooms: Optional[Set[str]],
+                in_frustum: Optional[Set[RenderObject]] = None) -> bool:
+        if in_frustum is not None and obj not in in_frustum:
+            return True
+        return visible_rooms is not None and self.visibility.culled(obj, visible_rooms)
 
     def render(self) -> None:
+        stats = self.stats
+        self._frame = self.assets.tick()
+        stats.begin_frame()
+        stats.begin_pass("cache")
         self.buildCache()
+        stats.end_pass()
+        stats.begin_pass("uploads")
+        self._advance_prefetch()
+        self._settle_objects()
+        self._upload_textures()
+        stats.end_pass()
+        self.assets.drawing = self
+        self.uniforms.begin_frame()
+        self._bound_textures.clear()
+        self._shader = None
+        target, width, height = self._bind_target()
 
         glClearColor(0.5, 0.5, 1, 1.0)
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
@@ -330,128 +856,252 @@ class Scene:
         else:
             glDisable(GL_CULL_FACE)
 
+        stats.begin_pass("main")
         glDisable(GL_BLEND)
-        self.shader.use()
-        self.shader.set_matrix4("view", self.camera.view())
-        self.shader.set_matrix4("projection", self.camera.projection())
+        self._use_shader(self.shader)
+        self.uniforms.bind_camera(self.camera.view(), self.camera.projection())
         self.shader.set_bool("enableLightmap", self.use_lightmap)
-        group1 = [obj for obj in self.objects.values() if obj.model not in self.SPECIAL_MODELS]
-        for obj in group1:
-            self._render_object(self.shader, obj, mat4())
+        self._update_render_lists()
+        visible_rooms = self._visible_rooms()
+        in_frustum = self._in_frustum()
+        room_draws, draws = [], []
+        for obj in self._main_objects:
+            if not self._culled(obj, visible_rooms, in_frustum):
+                self._gather_object(obj, mat4(), room_draws if isinstance(obj.data, LYTRoom) else draws)
+            else:
+                stats.frame.culled += 1
+        # Rooms go first so the depth captured for screenToWorld() holds nothing else
+        for group in (room_draws, draws):
+            # Meshes sharing textures (or texture arrays) are drawn back to back so their textures are only bound once,
+            # and copies of the same mesh next to each other so they can be instanced
+            group.sort(key=lambda draw: (*draw[0].sort_key(draw[2]), id(draw[0]), id(draw[2])))
+            self._draw_sorted(group)
+            if group is room_draws:
+                if self.depth_snapshot is None:
+                    self.depth_snapshot = DepthSnapshot(self.assets.resources, self)
+                self.depth_snapshot.capture(target, width, height, self.camera.view(), self.camera.projection())
+        stats.end_pass()
 
         # Draw all instance types that lack a proper model
+        stats.begin_pass("gizmo")
         glEnable(GL_BLEND)
-        self.plain_shader.use()
-        self.plain_shader.set_matrix4("view", self.camera.view())
-        self.plain_shader.set_matrix4("projection", self.camera.projection())
-        self.plain_shader.set_vector4("color", vec4(0.0, 0.0, 1.0, 0.4))
-        group2 = [obj for obj in self.objects.values() if obj.model in self.SPECIAL_MODELS]
-        for obj in group2:
-            self._render_object(self.plain_shader, obj, mat4())
+        self._use_shader(self.plain_shader)
+        self.uniforms.color = vec4(0.0, 0.0, 1.0, 0.4)
+        for obj in self._special_objects:
+            if not self._culled(obj, visible_rooms, in_frustum):
+                self._render_object(self.plain_shader, obj, mat4())
+            else:
+                stats.frame.culled += 1
+        stats.end_pass()
 
         # Draw bounding box for selected objects
-        self.plain_shader.set_vector4("color", vec4(1.0, 0.0, 0.0, 0.4))
+        stats.begin_pass("selection")
+        self.uniforms.color = vec4(1.0, 0.0, 0.0, 0.4)
         for obj in self.selection:
             obj.cube(self).draw(self.plain_shader, obj.transform())
 
         # Draw boundary for selected objects
         glDisable(GL_CULL_FACE)
-        self.plain_shader.set_vector4("color", vec4(0.0, 1.0, 0.0, 0.8))
+        self.uniforms.color = vec4(0.0, 1.0, 0.0, 0.8)
         for obj in self.selection:
             obj.boundary(self).draw(self.plain_shader, obj.transform())
+        stats.end_pass()
 
         # Draw non-selected boundaries
-        for obj in [obj for obj in self.objects.values() if obj.model == "sound" and not self.hide_sound_boundaries]:
-            obj.boundary(self).draw(self.plain_shader, obj.transform())
-        for obj in [obj for obj in self.objects.values() if obj.model == "encounter" and not self.hide_encounter_boundaries]:
-            obj.boundary(self).draw(self.plain_shader, obj.transform())
-        for obj in [obj for obj in self.objects.values() if obj.model == "trigger" and not self.hide_trigger_boundaries]:
-            obj.boundary(self).draw(self.plain_shader, obj.transform())
+        stats.begin_pass("boundaries")
+        if not self.hide_sound_boundaries:
+            for obj in self._categories["sounds"]:
+                obj.boundary(self).draw(self.plain_shader, obj.transform())
+        if not self.hide_encounter_boundaries:
+            for obj in self._categories["encounters"]:
+                obj.boundary(self).draw(self.plain_shader, obj.transform())
+        if not self.hide_trigger_boundaries:
+            for obj in self._categories["triggers"]:
+                obj.boundary(self).draw(self.plain_shader, obj.transform())
+        stats.end_pass()
 
         if self.show_cursor:
-            self.plain_shader.set_vector4("color", vec4(1.0, 0.0, 0.0, 0.4))
+            stats.begin_pass("cursor")
+            self.uniforms.color = vec4(1.0, 0.0, 0.0, 0.4)
             self._render_object(self.plain_shader, self.cursor, mat4())
+            stats.end_pass()
 
-    def _render_object(self, shader: Shader, obj: RenderObject, transform: mat4) -> None:
-        if isinstance(obj.data, GITCreature) and self.hide_creatures:
-            return
-        if isinstance(obj.data, GITPlaceable) and self.hide_placeables:
-            return
-        if isinstance(obj.data, GITDoor) and self.hide_doors:
-            return
-        if isinstance(obj.data, GITTrigger) and self.hide_triggers:
-            return
-        if isinstance(obj.data, GITEncounter) and self.hide_encounters:
-            return
-        if isinstance(obj.data, GITWaypoint) and self.hide_waypoints:
-            return
-        if isinstance(obj.data, GITSound) and self.hide_sounds:
-            return
-        if isinstance(obj.data, GITStore) and self.hide_sounds:
-            return
-        if isinstance(obj.data, GITCamera) and self.hide_cameras:
+        self.uniforms.end_frame()
+
+        if self._vram_changed:
+            self._vram_changed = False
+            self._evict()
+        self.assets.resources.end_frame()
+        self.assets.resources.collect(self)
+        stats.end_frame()
+
+    def _draw_sorted(self, draws: List[Tuple[Mesh, mat4, Optional[Texture]]]) -> None:
+        if not self.instancing:
+            for mesh, transform, override_texture in draws:
+                mesh.draw(self.shader, transform, override_texture)
             return
+        for (mesh, override_texture), run in groupby(draws, key=lambda draw: (draw[0], draw[2])):
+            transforms = [transform for _, transform, _ in run]
+            if len(transforms) > 1:
+                mesh.draw_instanced(self.shader, transforms, override_texture)
+            else:
+                mesh.draw(self.shader, transforms[0], override_texture)
+
+    def _bind_target(self) -> Tuple[int, int, int]:
+        """
+        Binds Scene.framebuffer, or keeps the framebuffer already bound, and returns its id and size.
+        """
+        if self.framebuffer is not None:
+            self.framebuffer.bind()
+            return self.framebuffer.id(), self.framebuffer.width, self.framebuffer.height
+        return framebuffer_bindings()[0], self.camera.width, self.camera.height
+
+    def _use_shader(self, shader: Shader) -> None:
+        if self._shader is not shader:
+            shader.use()
+            self._shader = shader
+            self.stats.frame.program_switches += 1
 
-        model = self.model(obj.model)
+    def _render_object(self, shader: Shader, obj: RenderObject, transform: mat4) -> None:
+        model = self._resolve_model(obj)
         transform = transform * obj.transform()
-        model.draw(shader, transform, override_texture=obj.override_texture)
+        model.draw(shader, transform, override_texture=self._resolve_override(obj))
 
         for child in obj.children:
             self._render_object(shader, child, transform)
 
+    def _gather_object(self, obj: RenderObject, transform: mat4, draws: List) -> None:
+        model = self._resolve_model(obj)
+        transform = transform * obj.transform()
+        model.gather(transform, draws, override_texture=self._resolve_override(obj))
+
+        for child in obj.children:
+            self._gather_object(child, transform, draws)
+
+    def _resolve_override(self, obj: RenderObject) -> Optional[Texture]:
+        if obj.override_texture is not None and obj._override is None:
+            obj._override = self.texture(obj.override_texture)
+        return obj._override
+
     def picker_render(self) -> None:
-        glClearColor(1.0, 1.0, 1.0, 1.0)
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
+        """
+        Renders the ID of every visible object into the pick buffer.
+        """
+        self._update_render_lists()
+        if self.pick_buffer is None:
+            self.pick_buffer = PickBuffer(self.camera.width, self.camera.height, self.assets.resources, self)
+        self.pick_buffer.resize(self.camera.width, self.camera.height)
+
+        self.assets.drawing = self
+        self.uniforms.begin_frame()
+        self._bound_textures.clear()
+        self._shader = None
+        self.pick_buffer.bind()
 
         if self.backface_culling:
             glEnable(GL_CULL_FACE)
         else:
             glDisable(GL_CULL_FACE)
+        glDisable(GL_BLEND)
 
-        self.picker_shader.use()
-        self.picker_shader.set_matrix4("view", self.camera.view())
-        self.picker_shader.set_matrix4("projection", self.camera.projection())
-        instances = list(self.objects.values())
-        for obj in instances:
-            int_rgb = instances.index(obj)
-            r = int_rgb & 0xFF
-            g = (int_rgb >> 8) & 0xFF
-            b = (int_rgb >> 16) & 0xFF
-            color = vec3(r / 255, g / 255, b / 255)
-            self.picker_shader.set_vector3("colorId", color)
+        self._use_shader(self.picker_shader)
+        self.uniforms.bind_camera(self.camera.view(), self.camera.projection())
+        visible_rooms = self._visible_rooms()
+        in_frustum = self._in_frustum()
+        for obj in self._main_objects + self._special_objects:
+            if not self._culled(obj, visible_rooms, in_frustum):
+                self.uniforms.object_id = self._object_ids[obj]
+                self._picker_render_object(obj, mat4())
+        self.uniforms.object_id = 0
 
-            self._picker_render_object(obj, mat4())
+        self.uniforms.end_frame()
+        self.pick_buffer.unbind()
+        self.pick_buffer.key = self._pick_key()
 
     def _picker_render_object(self, obj: RenderObject, transform: mat4) -> None:
-        if isinstance(obj.data, GITCreature) and self.hide_creatures:
-            return
-        if isinstance(obj.data, GITPlaceable) and self.hide_placeables:
-            return
-        if isinstance(obj.data, GITDoor) and self.hide_doors:
-            return
-        if isinstance(obj.data, GITTrigger) and self.hide_triggers:
-            return
-        if isinstance(obj.data, GITEncounter) and self.hide_encounters:
-            return
-        if isinstance(obj.data, GITWaypoint) and self.hide_waypoints:
-            return
-        if isinstance(obj.data, GITSound) and self.hide_sounds:
-            return
-        if isinstance(obj.data, GITStore) and self.hide_sounds:
-            return
-        if isinstance(obj.data, GITCamera) and self.hide_cameras:
-            return
-
-        model = self.model(obj.model)
-        model.draw(self.picker_shader, transform * obj.transform())
+        model = self._resolve_model(obj)
+        transform = transform * obj.transform()
+        model.draw(self.picker_shader, transform)
         for child in obj.children:
-            self._picker_render_object(child, obj.transform())
-
-    def pick(self, x, y) -> RenderObject:
-        self.picker_render()
-        pixel = glReadPixels(x, y, 1, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8)[0][0] >> 8
-        instances = list(self.objects.values())
-        return instances[pixel] if pixel != 0xFFFFFF else None
+            self._picker_render_object(child, transform)
+
+    def _pick_key(self) -> Tuple:
+        return (self.spatial.version, self._hidden_state, self._model_generation, self.camera.view().to_bytes(),
+                self.camera.projection().to_bytes(), self.camera.width, self.camera.height, self.backface_culling,
+                self.vis_culling, self.frustum_culling)
+
+    def _update_pick_buffer(self) -> None:
+        self._update_render_lists()
+        if self.pick_buffer is None or self.pick_buffer.key != self._pick_key() \
+                or (self.pick_buffer.width, self.pick_buffer.height) != (self.camera.width, self.camera.height):
+            self.picker_render()
+
+    def pick(self, x: int, y: int) -> Optional[RenderObject]:
+        """
+        Returns the object drawn at the given window coordinates (origin at the bottom left), waiting for the GPU.
+        """
+        if self.cpu_picking:
+            hit = self.raycast(x, self.camera.height - y)
+            return hit.obj if hit is not None else None
+        self._update_pick_buffer()
+        return self._id_objects.get(self.pick_buffer.read(x, y))
+
+    def hoverPick(self, x: int, y: int) -> Optional[RenderObject]:
+        """
+        Returns the object under the given window coordinates as of the last finished read, without waiting for the GPU.
+        """
+        if self.cpu_picking:
+            return self.pick(x, y)
+        self._update_pick_buffer()
+        object_id = self.pick_buffer.poll()
+        if object_id is not None:
+            self._hovered = self._id_objects.get(object_id)
+        self.pick_buffer.request(x, y)
+        return self._hovered
+
+    def raycast(self, x: int, y: int,
+                predicate: Optional[Callable[[RenderObject], bool]] = None) -> Optional[RaycastHit]:
+        """
+        Returns the nearest hit of a ray through the given screen coordinates (origin at the top left) against the
+        visible objects the predicate accepts, computed on the CPU.
+        """
+        self._update_render_lists()
+        view, projection = self.camera.view(), self.camera.projection()
+        viewport = vec4(0, 0, self.camera.width, self.camera.height)
+        near = glm.unProject(vec3(x, self.camera.height - y, 0.0), view, projection, viewport)
+        far = glm.unProject(vec3(x, self.camera.height - y, 1.0), view, projection, viewport)
+        direction = glm.normalize(far - near)
+
+        visible_rooms = self._visible_rooms()
+        best = None
+        for distance, obj in self.spatial.query_ray(near, direction, glm.distance(near, far)):
+            if best is not None and distance > best.distance:
+                break
+            if getattr(self, "hide_" + self.CATEGORIES.get(type(obj.data), "other"), False) \
+                    or (predicate is not None and not predicate(obj)) or self._culled(obj, visible_rooms):
+                continue
+            hit = self._raycast_object(obj, obj, mat4(), near, direction, best.distance if best else math.inf)
+            if hit is not None:
+                best = hit
+        return best
+
+    def _raycast_object(self, target: RenderObject, obj: RenderObject, transform: mat4, origin: vec3, direction: vec3,
+                        max_distance: float) -> Optional[RaycastHit]:
+        transform = transform * obj.transform()
+        inverse = glm.inverse(transform)
+        # The direction stays unnormalized in model space so ray parameters are world distances for every object
+        hit = self._resolve_model(obj).raycast(vec3(inverse * vec4(origin, 1.0)), vec3(inverse * vec4(direction, 0.0)),
+                                               max_distance)
+        best = None
+        if hit is not None:
+            distance, node = hit
+            best = RaycastHit(target, node, origin + direction * distance, distance)
+            max_distance = distance
+        for child in obj.children:
+            child_hit = self._raycast_object(target, child, transform, origin, direction, max_distance)
+            if child_hit is not None:
+                best, max_distance = child_hit, child_hit.distance
+        return best
 
     def select(self, target: Union[RenderObject, GITInstance], clear_existing: bool = True):
         if clear_existing:
@@ -467,6 +1117,35 @@ class Scene:
         self.selection.append(target)
 
     def screenToWorld(self, x: int, y: int) -> Vector3:
+        if self.cpu_picking:
+            hit = self.raycast(x, y, lambda obj: isinstance(obj.data, LYTRoom))
+            if hit is None:
+                # Where the depth buffer would have been left cleared
+                far = glm.unProject(vec3(x, self.camera.height - y, 1.0), self.camera.view(), self.camera.projection(),
+                                    vec4(0, 0, self.camera.width, self.camera.height))
+                return Vector3(far.x, far.y, far.z)
+            return Vector3(hit.point.x, hit.point.y, hit.point.z)
+
+        snapshot = self.depth_snapshot
+        if snapshot is not None:
+            snapshot.poll()
+            depth = snapshot.depth_at(x, self.camera.height - y)
+            if depth is not None and (snapshot.width, snapshot.height) == (self.camera.width, self.camera.height):
+                cursor = glm.unProject(vec3(x, self.camera.height - y, depth), snapshot.view, snapshot.projection,
+                                       vec4(0, 0, snapshot.width, snapshot.height))
+                return Vector3(cursor.x, cursor.y, cursor.z)
+
+        # Nothing has been read back for this size yet, so render the rooms and read the depth directly
+        previous = framebuffer_bindings()
+        self.assets.drawing = self
+        self.uniforms.begin_frame()
+        self._bound_textures.clear()
+        self._shader = None
+        if self._depth_target is None:
+            self._depth_target = Framebuffer(self.camera.width, self.camera.height, self.assets.resources, self)
+        self._depth_target.resize(self.camera.width, self.camera.height)
+        self._depth_target.bind()
+
         glClearColor(0.5, 0.5, 1, 1.0)
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
 
@@ -476,85 +1155,315 @@ class Scene:
             glDisable(GL_CULL_FACE)
 
         glDisable(GL_BLEND)
-        self.shader.use()
-        self.shader.set_matrix4("view", self.camera.view())
-        self.shader.set_matrix4("projection", self.camera.projection())
-        group1 = [obj for obj in self.objects.values() if isinstance(obj.data, LYTRoom)]
-        for obj in group1:
-            self._render_object(self.shader, obj, mat4())
+        self._use_shader(self.shader)
+        self.uniforms.bind_camera(self.camera.view(), self.camera.projection())
+        visible_rooms = self._visible_rooms()
+        for obj in self._categories["rooms"]:
+            if not self._culled(obj, visible_rooms):
+                self._render_object(self.shader, obj, mat4())
+        self.uniforms.end_frame()
 
         zpos = glReadPixels(x, self.camera.height-y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT)[0][0]
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous[0])
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previous[1])
         cursor = glm.unProject(vec3(x, self.camera.height-y, zpos), self.camera.view(), self.camera.projection(), vec4(0, 0, self.camera.width, self.camera.height))
         return Vector3(cursor.x, cursor.y, cursor.z)
 
     def texture(self, name: str) -> Texture:
-        if name not in self.textures:
-            try:
-                tpc = None
+        """
+        Returns the texture handle for the given name, which stays the same for the lifetime of the scene.
+        """
+        if name in self.textures:
+            self.stats.frame.texture_hits += 1
+        else:
+            self.stats.frame.texture_misses += 1
+            self._texture_names.add(name.lower())
+            key = self._texture_key(name)
+            shared = self.assets.find(key)
+            if shared is not None:
+                self.textures[name] = shared.value
+            elif not self.texture_loader.asynchronous():
+                self.textures[name] = self._load_texture(name)
+            else:
+                # Draw with the blank texture until a worker has loaded the TPC and the render loop has uploaded it
+                self.textures[name] = Texture(self.textures["NULL"].id())
+                self._request_texture(name)
+            if shared is None:
+                shared = self.assets.share(key, self.textures[name])
+            self._texture_assets[name.lower()] = shared
+        return self.textures[name]
+
+    def _texture_key(self, name: str) -> Tuple:
+        if self.resource_index is not None:
+            found = self.resource_index.locate(name, [ResourceType.TPC, ResourceType.TGA], TEXTURE_SEARCH_ORDER)
+            return "texture", name.lower(), found[1] if found is not None else None
+        return "texture", name.lower(), self._search_scope()
+
+    def _model_key(self, name: str) -> Tuple:
+        if name in PREDEFINED_MODELS:
+            return "model", name, None
+        if self.resource_index is not None:
+            mdl = self.resource_index.locate(name, [ResourceType.MDL], SEARCH_ORDER)
+            mdx = self.resource_index.locate(name, [ResourceType.MDX], SEARCH_ORDER)
+            return "model", name.lower(), mdl[1] if mdl is not None else None, mdx[1] if mdx is not None else None
+        return "model", name.lower(), self._search_scope()
+
+    def _search_scope(self) -> Tuple:
+        """
+        Stands in for the file a resource was loaded from when there is no resource index.
+        """
+        return str(self.installation.path()) if self.installation is not None else None, self.module
+
+    def _request_texture(self, name: str) -> None:
+        """
+        Loads the texture again into its existing handle.
+        """
+        self.assets.evicted_textures.pop(self.textures[name], None)
+        if not self.texture_loader.asynchronous():
+            self._replace_texture(self.textures[name], self._load_texture(name))
+        else:
+            self.texture_loader.request(self.textures[name], self._find_tpc, name)
+
+    def _upload_textures(self) -> None:
+        """
+        Uploads finished textures within texture_upload_budget, and the next mip levels of streamed ones.
+        """
+        streaming = self.texture_streamer is not None and len(self.texture_streamer) > 0
+        if not self.texture_loader.pending and not streaming:
+            return
+
+        self.pixel_uploads.begin_frame()
+        for texture, tpc in self.texture_loader.finished(time.perf_counter() + self.texture_upload_budget):
+            self._replace_texture(texture, self._upload_tpc(tpc, self.pixel_uploads))
+        if self.texture_streamer is not None:
+            self.texture_streamer.upload(self.pixel_uploads)
+        self.pixel_uploads.end_frame()
+
+        self._bound_textures.clear()
+
+    def waitForTextures(self) -> None:
+        """
+        Blocks until every requested texture has been loaded and uploaded at full resolution.
+        """
+        for texture, tpc in self.texture_loader.finished():
+            self._replace_texture(texture, self._upload_tpc(tpc))
+        if self.texture_streamer is not None:
+            self.texture_streamer.finish()
+        self._bound_textures.clear()
+
+    def bind_texture(self, texture: Texture, unit: int) -> None:
+        """
+        Binds the texture for the sampler on the given unit, skipping the call if it is already bound there.
+        """
+        texture.last_used = self._frame
+        evicted = self.assets.evicted_textures
+        if evicted and texture in evicted:
+            self._request_texture(evicted.pop(texture))
+
+        unit = texture.unit(unit)
+        if self._bound_textures.get(unit) != texture.id():
+            glActiveTexture(GL_TEXTURE0 + unit)
+            texture.use()
+            self._bound_textures[unit] = texture.id()
+            self.stats.frame.texture_binds += 1
+
+    def _load_texture(self, name: str) -> Texture:
+        return self._upload_tpc(self._find_tpc(name))
+
+    def _find_tpc(self, name: str) -> Optional[TPC]:
+        try:
+            tpc = None
+            if self.resource_index is not None:
+                found = self.resource_index.locate(name, [ResourceType.TPC, ResourceType.TGA], TEXTURE_SEARCH_ORDER)
+                tpc = read_tpc(ResourceIndex.read(found[1])) if found is not None else None
+            else:
                 # Check the textures linked to the module first
                 if self.module is not None:
                     tpc = self.module.texture(name).resource() if self.module.texture(name) is not None else None
                 # Otherwise just search through all relevant game files
-                tpc = self.installation.texture(name, [SearchLocation.OVERRIDE, SearchLocation.TEXTURES_TPA,
-                                                       SearchLocation.CHITIN]) if tpc is None else tpc
-            except (ValueError, IOError):
-                # If an error occurs during the loading process, just use a blank image.
-                tpc = TPC()
-
-            self.textures[name] = Texture.from_tpc(tpc) if tpc is not None else Texture.from_color(255, 0, 255)
-        return self.textures[name]
+                if tpc is None and self.installation is not None:
+                    tpc = self.installation.texture(name, [SearchLocation.OVERRIDE, SearchLocation.TEXTURES_TPA,
+                                                           SearchLocation.CHITIN])
+        except (ValueError, IOError):
+            # If an error occurs during the loading process, just use a blank image.
+            tpc = TPC()
+
+        if tpc is not None and self.transcoder is not None:
+            tpc = self.transcoder.transcode(tpc)
+        return tpc
+
+    def _upload_tpc(self, tpc: Optional[TPC], pixels: Optional[PixelUploadRing] = None) -> Texture:
+        if tpc is None:
+            texture = Texture.from_color(255, 0, 255)
+        else:
+            texture = self.texture_arrays.pack(tpc) if self.texture_arrays is not None else None
+            if texture is None and self.texture_streamer is not None:
+                texture = self.texture_streamer.load(tpc, pixels)
+            elif texture is None:
+                texture = Texture.from_tpc(tpc, pixels=pixels)
+
+        if texture.layer < 0:
+            self.assets.resources.track(TEXTURE, texture.id(), texture.size)
+        # Uploading bound the new texture to whichever unit was active
+        self._bound_textures.clear()
+        self._vram_changed = True
+        return texture
+
+    def vramUsage(self) -> int:
+        """
+        Returns the bytes of textures and models the scene holds on the GPU, counting packed textures by their layers.
+        """
+        return vram_usage((self.textures[name] for name in self._texture_names),
+                          (self.models[name] for name in self._model_names))
+
+    def _evict(self) -> None:
+        """
+        Frees the least recently drawn textures and models until the scene fits in vram_budget.
+        """
+        null_id = self.textures["NULL"].id()
+        pending = self.texture_loader.pending
+        textures = {name: self.textures[name] for name in self._texture_names
+                    if self.textures[name].id() != null_id and self.textures[name] not in pending}
+        evict(self.vramUsage(), self.vram_budget, self._frame, textures,
+              {name: self.models[name] for name in self._model_names}, self._evict_texture, self._evict_model)
+
+    def _evict_texture(self, name: str) -> int:
+        texture = self.textures[name]
+        freed = self._replace_texture(texture, Texture(self.textures["NULL"].id()))
+        self.assets.evicted_textures[texture] = name
+        return freed
+
+    def _replace_texture(self, texture: Texture, replacement: Texture) -> int:
+        """
+        Points the handle at another GL texture, releases the one it held and returns the bytes freed.
+        """
+        freed = 0
+        if texture.id() != self.textures["NULL"].id() \
+                and (texture.id(), texture.layer) != (replacement.id(), replacement.layer):
+            freed = self._release_texture(texture)
+        texture.replace(replacement)
+        self._bound_textures.clear()
+        return freed
+
+    def _release_texture(self, texture: Texture) -> int:
+        if texture.layer >= 0:
+            return self.assets.texture_arrays.free(texture) if self.assets.texture_arrays is not None else 0
+        for scene in self.assets.scenes:
+            if scene.texture_streamer is not None:
+                scene.texture_streamer.cancel(texture.id())
+        self.assets.resources.release(TEXTURE, texture.id())
+        return texture.size
+
+    def _evict_model(self, name: str) -> int:
+        size = self.models[name].size()
+        self._drop_model(name)
+        return size
+
+    def _drop_model(self, name: str) -> None:
+        """
+        Removes a model from the scene, deleting it unless another scene still holds it.
+        """
+        name = name.lower()
+        model = self.models[name]
+        del self.models[name]
+        self._model_names.discard(name)
+        self._model_generation += 1
+        model.detach(self)
+        if self.assets.release(self._model_assets.pop(name)):
+            model.release()
 
     def model(self, name: str) -> Model:
+        if name in self.models:
+            self.stats.frame.model_hits += 1
+        else:
+            self.stats.frame.model_misses += 1
+            # A model prefetchModule() has started parsing is waited for rather than read again
+            future = self._pending_models.pop(name.lower(), None)
+            key = self._model_key(name)
+            shared = self.assets.find(key)
+            if shared is None:
+                data = future.result() if future is not None else self._parse_model(name)
+                shared = self.assets.share(key, build_stitched_model(self, data))
+                self._vram_changed = True
+            elif future is not None:
+                future.cancel()
+            self.models[name] = shared.value
+            self._model_assets[name.lower()] = shared
+            self._model_names.add(name.lower())
+            self._residency_changed = True
+        return self.models[name]
+
+    def _parse_model(self, name: str) -> StitchedModelData:
+        mdl_data, mdx_data = self._find_model(name)
+        try:
+            if self.model_cache is not None:
+                return self.model_cache.parse(mdl_data, mdx_data)
+            return parse_stitched_model(BinaryReader.from_bytes(mdl_data, 12), BinaryReader.from_bytes(mdx_data))
+        except Exception:
+            return parse_stitched_model(BinaryReader.from_bytes(EMPTY_MDL_DATA, 12),
+                                        BinaryReader.from_bytes(EMPTY_MDX_DATA))
+
+    def _find_model(self, name: str) -> Tuple[bytes, bytes]:
+        """
+        Returns the MDL and MDX data of a model, or those of the empty model if it cannot be found.
+        """
         mdl_data = EMPTY_MDL_DATA
         mdx_data = EMPTY_MDX_DATA
 
-        if name not in self.models:
-            if name == "waypoint":
-                mdl_data = WAYPOINT_MDL_DATA
-                mdx_data = WAYPOINT_MDX_DATA
-            elif name == "sound":
-                mdl_data = SOUND_MDL_DATA
-                mdx_data = SOUND_MDX_DATA
-            elif name == "store":
-                mdl_data = STORE_MDL_DATA
-                mdx_data = STORE_MDX_DATA
-            elif name == "entry":
-                mdl_data = ENTRY_MDL_DATA
-                mdx_data = ENTRY_MDX_DATA
-            elif name == "encounter":
-                mdl_data = ENCOUNTER_MDL_DATA
-                mdx_data = ENCOUNTER_MDX_DATA
-            elif name == "trigger":
-                mdl_data = TRIGGER_MDL_DATA
-                mdx_data = TRIGGER_MDX_DATA
-            elif name == "camera":
-                mdl_data = CAMERA_MDL_DATA
-                mdx_data = CAMERA_MDX_DATA
-            elif name == "empty":
-                mdl_data = EMPTY_MDL_DATA
-                mdx_data = EMPTY_MDX_DATA
-            elif name == "cursor":
-                mdl_data = CURSOR_MDL_DATA
-                mdx_data = CURSOR_MDX_DATA
-            elif name == "unknown":
-                mdl_data = UNKNOWN_MDL_DATA
-                mdx_data = UNKNOWN_MDX_DATA
-            elif self.installation is not None:
-                capsules = [] if self.module is None else self.module.capsules()
-                mdl_search = self.installation.resource(name, ResourceType.MDL, SEARCH_ORDER, capsules=capsules)
-                mdx_search = self.installation.resource(name, ResourceType.MDX, SEARCH_ORDER, capsules=capsules)
-                if mdl_search and mdx_search:
-                    mdl_data = mdl_search.data
-                    mdx_data = mdx_search.data
-
-            # model = gl_load_mdl(self, BinaryReader.from_bytes(mdl_data, 12), BinaryReader.from_bytes(mdx_data))
-            try:
-                model = gl_load_stitched_model(self, BinaryReader.from_bytes(mdl_data, 12), BinaryReader.from_bytes(mdx_data))
-            except Exception:
-                model = gl_load_stitched_model(self, BinaryReader.from_bytes(EMPTY_MDL_DATA, 12), BinaryReader.from_bytes(EMPTY_MDX_DATA))
-
-            self.models[name] = model
-        return self.models[name]
+        if name in PREDEFINED_MODELS:
+            mdl_data, mdx_data = PREDEFINED_MODELS[name]
+        elif self.resource_index is not None:
+            mdl_found = self.resource_index.data(name, ResourceType.MDL, SEARCH_ORDER)
+            mdx_found = self.resource_index.data(name, ResourceType.MDX, SEARCH_ORDER) if mdl_found else None
+            if mdl_found is not None and mdx_found is not None:
+                mdl_data = mdl_found
+                mdx_data = mdx_found
+        elif self.installation is not None:
+            capsules = [] if self.module is None else self.module.capsules()
+            mdl_search = self.installation.resource(name, ResourceType.MDL, SEARCH_ORDER, capsules=capsules)
+            mdx_search = self.installation.resource(name, ResourceType.MDX, SEARCH_ORDER, capsules=capsules)
+            if mdl_search and mdx_search:
+                mdl_data = mdl_search.data
+                mdx_data = mdx_search.data
+        elif self.module is not None:
+            # Without an installation the module's own resources are all there is, as with a SyntheticModule
+            mdl_resource, mdx_resource = self.module.model(name), self.module.model_ext(name)
+            if mdl_resource is not None and mdx_resource is not None:
+                mdl_data = mdl_resource.data()
+                mdx_data = mdx_resource.data()
+
+        return mdl_data, mdx_data
+
+    def roomBounds(self) -> Optional[Tuple[vec3, vec3]]:
+        """
+        Returns the world-space box enclosing every room of the layout, or None if there are no rooms.
+        """
+        self.buildCache()
+        bounds = [self.spatial.bounds(obj) for obj in self._categories["rooms"]]
+        if not bounds:
+            return None
+        return vec3(*(min(box[i] for box in bounds) for i in range(3))), \
+            vec3(*(max(box[i] for box in bounds) for i in range(3, 6)))
+
+    def frameTopDown(self, margin: float = 0.05) -> None:
+        """
+        Points an orthographic camera straight down at the layout with the given margin around the rooms.
+        """
+        bounds = self.roomBounds()
+        if bounds is None:
+            return
+        min_point, max_point = bounds
+
+        self.camera.orthographic = True
+        self.camera.x = (min_point.x + max_point.x) / 2
+        self.camera.y = (min_point.y + max_point.y) / 2
+        self.camera.z = max_point.z
+        self.camera.distance = 10.0
+        self.camera.pitch = math.pi
+        self.camera.yaw = -math.pi / 2
+        aspect = self.camera.width / self.camera.height
+        extent = max(max_point.y - min_point.y, (max_point.x - min_point.x) / aspect)
+        self.camera.ortho_height = extent * (1 + margin * 2)
 
     def jumpToEntryLocation(self) -> None:
         if self.module is None:
@@ -567,6 +1476,71 @@ class Scene:
             self.camera.y = point.y
             self.camera.z = point.z + 1.8
 
+    def release(self) -> None:
+        """
+        Deletes the GL objects the scene owns and gives up its share of the asset context; the scene cannot be used
+        afterwards.
+        """
+        self._cancel_prefetch()
+        self.texture_loader.shutdown()
+
+        for name in list(self._model_assets):
+            self._drop_model(name)
+
+        null_id = self.textures["NULL"].id()
+        released = []
+        for shared in self._texture_assets.values():
+            if self.assets.release(shared):
+                released.append(shared.value)
+        for texture in released:
+            self.texture_loader.cancel(texture)
+            self.assets.evicted_textures.pop(texture, None)
+            for scene in self.assets.scenes:
+                if scene.texture_streamer is not None:
+                    scene.texture_streamer.cancel(texture.id())
+        # Mip levels still queued here belong to textures other scenes hold
+        if self.texture_streamer is not None:
+            self.texture_streamer.finish()
+        for texture in released:
+            if texture.id() != null_id and texture.layer >= 0 and self.assets.texture_arrays is not None:
+                self.assets.texture_arrays.free(texture)
+            elif texture.id() != null_id:
+                self.assets.resources.release(TEXTURE, texture.id())
+        self._texture_assets.clear()
+        self.textures = CaseInsensitiveDict()
+
+        self._release_objects()
+        self.objects = {}
+        self.cursor.release()
+
+        for owned in (self.pick_buffer, self.depth_snapshot, self._depth_target, self.framebuffer):
+            if owned is not None:
+                owned.release()
+        self.pick_buffer = self.depth_snapshot = self._depth_target = self.framebuffer = None
+        self.uniforms.release()
+        self.pixel_uploads.release()
+        self.stats.release()
+        self.assets.resources.flush(self)
+        self.assets.detach(self)
+
+    def resourceReport(self) -> Dict[str, Tuple[int, int]]:
+        """
+        Returns the number and bytes of the live GL objects of the scene's asset context, by kind.
+        """
+        return self.assets.resources.report()
+
+
+class RaycastHit:
+    """
+    The result of Scene.raycast(): the object and model node that were hit, and the point and distance of the hit.
+    """
+
+    def __init__(self, obj: RenderObject, node: Node, point: vec3, distance: float):
+        self.obj: RenderObject = obj
+        self.node: Node = node
+        self.point: vec3 = point
+        self.distance: float = distance
+
 
 class RenderObject:
     def __init__(self, model: str, position: vec3 = None, rotation: vec3 = None, *, data: Any = None,
@@ -577,10 +1551,15 @@ class RenderObject:
         self._position: vec3 = position if position is not None else vec3()
         self._rotation: vec3 = rotation if rotation is not None else vec3()
         self._cube: Optional[Cube] = None
+        self._bounds: Optional[Tuple[vec3, vec3]] = None
         self._boundary: Optional[Boundary] = None
         self.genBoundary: Optional[Callable[[], Boundary]] = genBoundary
         self.data: Any = data
         self.override_texture: Optional[str] = override_texture
+        self._spatial: Optional[LooseOctree[RenderObject]] = None
+        self._model: Optional[Model] = None
+        self._model_generation: int = -1
+        self._override: Optional[Texture] = None
 
         self._recalc_transform()
 
@@ -592,10 +1571,14 @@ class RenderObject:
         rotation = quat()
         glm.decompose(transform, vec3(), rotation, self._position, vec3(), vec4())
         self._rotation = glm.eulerAngles(rotation)
+        if self._spatial is not None:
+            self._spatial.update(self)
 
     def _recalc_transform(self) -> None:
         self._transform = mat4() * glm.translate(self._position)
         self._transform = self._transform * glm.mat4_cast(quat(self._rotation))
+        if self._spatial is not None:
+            self._spatial.update(self)
 
     def position(self) -> vec3:
         return copy(self._position)
@@ -617,16 +1600,51 @@ class RenderObject:
         self._rotation = vec3(x, y, z)
         self._recalc_transform()
 
+    def models(self) -> List[str]:
+        """
+        Returns the names of the models the object and its children are drawn with.
+        """
+        names = [self.model]
+        for child in self.children:
+            names.extend(child.models())
+        return names
+
     def reset_cube(self) -> None:
+        if self._cube is not None:
+            self._cube.release()
         self._cube = None
+        self._bounds = None
+        if self._spatial is not None:
+            self._spatial.update(self)
 
     def cube(self, scene: Scene) -> Cube:
         if not self._cube:
+            min_point, max_point = self.bounds(scene)
+            self._cube = Cube(scene, min_point, max_point)
+        return self._cube
+
+    def bounds(self, scene: Scene) -> Tuple[vec3, vec3]:
+        """
+        Returns the bounding box of the object and its children in model space.
+        """
+        if self._bounds is None:
             min_point = vec3(10000, 10000, 10000)
             max_point = vec3(-10000, -10000, -10000)
             self._cube_rec(scene, mat4(), self, min_point, max_point)
-            self._cube = Cube(scene, min_point, max_point)
-        return self._cube
+            self._bounds = (min_point, max_point)
+        return self._bounds
+
+    def world_bounds(self, scene: Scene) -> Tuple[vec3, vec3]:
+        """
+        Returns the axis-aligned box enclosing bounds() after it has been transformed into world space.
+        """
+        min_point, max_point = self.bounds(scene)
+        corners = [self._transform * vec3(x, y, z) for x in (min_point.x, max_point.x)
+                   for y in (min_point.y, max_point.y) for z in (min_point.z, max_point.z)]
+        return vec3(min(corner.x for corner in corners), min(corner.y for corner in corners),
+                    min(corner.z for corner in corners)), \
+            vec3(max(corner.x for corner in corners), max(corner.y for corner in corners),
+                 max(corner.z for corner in corners))
 
     def radius(self, scene: Scene) -> float:
         cube = self.cube(scene)
@@ -647,8 +1665,21 @@ class RenderObject:
             self._cube_rec(scene, transform * child.transform(), child, min_point, max_point)
 
     def reset_boundary(self) -> None:
+        if self._boundary is not None:
+            self._boundary.release()
         self._boundary = None
 
+    def release(self) -> None:
+        """
+        Releases the cube and boundary of the object and its children.
+        """
+        if self._cube is not None:
+            self._cube.release()
+            self._cube = None
+        self.reset_boundary()
+        for child in self.children:
+            child.release()
+
     def boundary(self, scene: Scene) -> Boundary | Empty:
         if not self._boundary:
             if self.genBoundary is None:
@@ -669,6 +1700,9 @@ class Camera:
         self.yaw: float = 0.0
         self.distance: float = 10.0
         self.fov: float = 90.0
+        self.orthographic: bool = False
+        # World units covered by the height of the view when orthographic
+        self.ortho_height: float = 100.0
 
     def view(self) -> mat4:
         up = vec3(0, 0, 1)
@@ -685,6 +1719,10 @@ class Camera:
         return glm.inverse(camera)
 
     def projection(self) -> mat4:
+        if self.orthographic:
+            half_height = self.ortho_height / 2
+            half_width = half_height * self.width / self.height
+            return glm.ortho(-half_width, half_width, -half_height, half_height, 0.1, 5000)
         return glm.perspective(self.fov, self.width/self.height, 0.1, 5000)
 
     def translate(self, translation: vec3) -> None:
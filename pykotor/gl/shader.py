@@ -8,13 +8,59 @@ from OpenGL.GL.shaders import GL_FALSE
 from OpenGL.raw.GL.EXT.texture_compression_s3tc import GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
 from OpenGL.raw.GL.VERSION.GL_1_0 import GL_TEXTURE_2D, glTexParameteri, GL_RGB, GL_UNSIGNED_BYTE, \
     GL_CLAMP, GL_LINEAR, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T, GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_REPEAT, \
-    GL_RGBA, GL_NEAREST_MIPMAP_LINEAR
+    GL_RGBA, GL_NEAREST_MIPMAP_LINEAR, glPixelStorei, GL_UNPACK_ALIGNMENT
 from OpenGL.raw.GL.VERSION.GL_1_1 import glBindTexture
+from OpenGL.raw.GL.VERSION.GL_1_2 import GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL
 from OpenGL.raw.GL.VERSION.GL_1_3 import glCompressedTexImage2D
 from OpenGL.raw.GL.VERSION.GL_2_0 import GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, glUseProgram, glUniform1i
+from OpenGL.raw.GL.VERSION.GL_3_1 import glGetUniformBlockIndex, glUniformBlockBinding, GL_INVALID_INDEX
 from glm import mat4, vec4, vec3
 from pykotor.resource.formats.tpc import TPC, TPCTextureFormat
 
+from typing import TYPE_CHECKING, Optional
+if TYPE_CHECKING:
+    from pykotor.gl.buffer import PixelUploadRing
+
+# Uniform buffer binding points of the blocks streamed by UniformStream
+FRAME_BINDING = 0
+OBJECT_BINDING = 1
+INSTANCE_BINDING = 2
+
+# Transforms held by the Instances block, which is the most one instanced draw call can draw
+MAX_INSTANCES = 256
+
+# Texture units sampled by the KotOR shader. Textures packed into a texture array are bound to the array unit instead
+# and picked by the layer index in the Object block.
+DIFFUSE_UNIT = 0
+LIGHTMAP_UNIT = 1
+ARRAY_UNIT_OFFSET = 2
+
+FRAME_BLOCK = """
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+};
+"""
+
+OBJECT_BLOCK = """
+layout (std140) uniform Object
+{
+    mat4 model;
+    vec4 color;
+    // x and y: texture array layers of the diffuse and lightmap textures; z: object ID written by the picker;
+    // w: 1 if the draw is instanced and the model matrices are in the Instances block
+    ivec4 layers;
+};
+"""
+
+INSTANCE_BLOCK = """
+layout (std140) uniform Instances
+{
+    mat4 instances[""" + str(MAX_INSTANCES) + """];
+};
+"""
+
 KOTOR_VSHADER = """
 #version 330 core
 
@@ -27,13 +73,11 @@ layout (location = 4) in vec3 uv2;
 out vec2 diffuse_uv;
 out vec2 lightmap_uv;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
+""" + FRAME_BLOCK + OBJECT_BLOCK + INSTANCE_BLOCK + """
 void main()
 {
-    gl_Position = projection * view * model *  vec4(position, 1.0);
+    mat4 transform = layers.w != 0 ? instances[gl_InstanceID] : model;
+    gl_Position = projection * view * transform *  vec4(position, 1.0);
     diffuse_uv = vec2(uv.x, uv.y);
     lightmap_uv = vec2(uv2.x, uv2.y);
 }
@@ -49,13 +93,17 @@ out vec4 FragColor;
 
 layout(binding = 0) uniform sampler2D diffuse;
 layout(binding = 1) uniform sampler2D lightmap;
+layout(binding = 2) uniform sampler2DArray diffuseArray;
+layout(binding = 3) uniform sampler2DArray lightmapArray;
 uniform int enableLightmap;
-
+""" + OBJECT_BLOCK + """
 void main()
 {
-    vec4 diffuseColor = texture(diffuse, diffuse_uv);
-    vec4 lightmapColor = texture(lightmap, lightmap_uv);
-    
+    vec4 diffuseColor = layers.x >= 0 ? texture(diffuseArray, vec3(diffuse_uv, layers.x))
+                                      : texture(diffuse, diffuse_uv);
+    vec4 lightmapColor = layers.y >= 0 ? texture(lightmapArray, vec3(lightmap_uv, layers.y))
+                                       : texture(lightmap, lightmap_uv);
+
     if (enableLightmap == 1) {
         FragColor = mix(diffuseColor, lightmapColor, 0.5);
     } else {
@@ -70,10 +118,7 @@ PICKER_VSHADER = """
 
 layout (location = 1) in vec3 position;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
+""" + FRAME_BLOCK + OBJECT_BLOCK + """
 void main()
 {
     gl_Position = projection * view * model *  vec4(position, 1.0);
@@ -84,13 +129,12 @@ void main()
 PICKER_FSHADER = """
 #version 330
 
-uniform vec3 colorId;
-
-out vec4 FragColor;
+""" + OBJECT_BLOCK + """
+layout (location = 0) out uint objectId;
 
 void main()
 {
-    FragColor = vec4(colorId, 1.0);
+    objectId = uint(layers.z);
 }
 """
 
@@ -100,10 +144,7 @@ PLAIN_VSHADER = """
 
 layout (location = 1) in vec3 position;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
+""" + FRAME_BLOCK + OBJECT_BLOCK + """
 void main()
 {
     gl_Position = projection * view * model *  vec4(position, 1.0);
@@ -114,8 +155,7 @@ void main()
 PLAIN_FSHADER = """
 #version 330
 
-uniform vec4 color;
-
+""" + OBJECT_BLOCK + """
 out vec4 FragColor;
 
 void main()
@@ -130,10 +170,21 @@ class Shader:
         vertex_shader = shaders.compileShader(vshader, GL_VERTEX_SHADER)
         fragment_shader = shaders.compileShader(fshader, GL_FRAGMENT_SHADER)
         self._id: int = shaders.compileProgram(vertex_shader, fragment_shader)
+        self.bind_block("Frame", FRAME_BINDING)
+        self.bind_block("Object", OBJECT_BINDING)
+        self.bind_block("Instances", INSTANCE_BINDING)
 
     def use(self) -> None:
         glUseProgram(self._id)
 
+    def id(self) -> int:
+        return self._id
+
+    def bind_block(self, block_name: str, binding: int) -> None:
+        index = glGetUniformBlockIndex(self._id, block_name.encode())
+        if index != GL_INVALID_INDEX:
+            glUniformBlockBinding(self._id, index, binding)
+
     def uniform(self, uniform_name: str) -> None:
         return glGetUniformLocation(self._id, uniform_name)
 
@@ -151,33 +202,74 @@ class Shader:
 
 
 class Texture:
-    def __init__(self, tex_id: int):
+    def __init__(self, tex_id: int, target: int = GL_TEXTURE_2D, layer: int = -1, size: int = 0):
         self._id = tex_id
+        self._target: int = target
+        self.layer: int = layer
+        # Bytes the texture occupies on the GPU once fully uploaded, and the frame it was last bound in
+        self.size: int = size
+        self.last_used: int = 0
 
     @classmethod
-    def from_tpc(cls, tpc: TPC) -> Texture:
-        width, height, tpc_format, data = tpc.get(0)
-        imageSize = len(data)
+    def from_tpc(cls, tpc: TPC, base_level: int = 0, pixels: Optional[PixelUploadRing] = None) -> Texture:
+        """
+        Uploads the mip chain stored in the TPC, starting from base_level.
+        """
+        levels = max(1, tpc.mipmap_count())
 
         gl_id = glGenTextures(1)
         glBindTexture(GL_TEXTURE_2D, gl_id)
 
-        if tpc_format == TPCTextureFormat.DXT1:
-            glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0, imageSize, data)
-        if tpc_format == TPCTextureFormat.DXT5:
-            glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, width, height, 0, imageSize, data)
-        if tpc_format == TPCTextureFormat.RGB:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data)
-        if tpc_format == TPCTextureFormat.RGBA:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data)
+        for level in range(base_level, levels):
+            cls._upload(tpc, level, pixels)
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR)
-        glGenerateMipmap(GL_TEXTURE_2D)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base_level)
+        size = sum(len(tpc.get(level)[3]) for level in range(levels))
+        if levels > 1:
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1)
+        else:
+            glGenerateMipmap(GL_TEXTURE_2D)
+            size = size * 4 // 3
+
+        return Texture(gl_id, size=size)
+
+    @staticmethod
+    def _upload(tpc: TPC, level: int, pixels: Optional[PixelUploadRing] = None) -> int:
+        width, height, tpc_format, data = tpc.get(level)
+        imageSize = len(data)
+        if pixels is not None:
+            data = pixels.stage(data)
 
-        return Texture(gl_id)
+        if tpc_format == TPCTextureFormat.DXT1:
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0, imageSize,
+                                   data)
+        if tpc_format == TPCTextureFormat.DXT5:
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, width, height, 0,
+                                   imageSize, data)
+        if tpc_format == TPCTextureFormat.RGB:
+            # Rows of small RGB mips are not 4-byte aligned
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4)
+        if tpc_format == TPCTextureFormat.RGBA:
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data)
+
+        if pixels is not None:
+            pixels.unbind()
+        return imageSize
+
+    def upload_level(self, tpc: TPC, level: int, pixels: Optional[PixelUploadRing] = None) -> int:
+        """
+        Uploads a mip level above the current base level, makes it the base level and returns the bytes uploaded.
+        """
+        glBindTexture(GL_TEXTURE_2D, self._id)
+        size = self._upload(tpc, level, pixels)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level)
+        return size
 
     @classmethod
     def from_color(cls, r: int = 0, g: int = 0, b: int = 0) -> Texture:
@@ -194,7 +286,25 @@ class Texture:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR)
-        return Texture(gl_id)
+        return Texture(gl_id, size=len(pixels))
+
+    def replace(self, texture: Texture) -> None:
+        """
+        Takes over the GL texture of another instance, so everything holding this handle draws the new image.
+        """
+        self._id = texture._id
+        self._target = texture._target
+        self.layer = texture.layer
+        self.size = texture.size
+
+    def id(self) -> int:
+        return self._id
+
+    def unit(self, unit: int) -> int:
+        """
+        Returns the texture unit the shader samples this texture from.
+        """
+        return unit if self.layer < 0 else unit + ARRAY_UNIT_OFFSET
 
     def use(self) -> None:
-        glBindTexture(GL_TEXTURE_2D, self._id)
+        glBindTexture(self._target, self._id)
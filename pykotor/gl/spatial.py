@@ -0,0 +1,242 @@
+from __future__ import annotations
+
+import math
+from typing import Callable, Dict, Generic, Iterator, List, Optional, Tuple, TypeVar
+
+from glm import mat4, vec3
+
+T = TypeVar("T")
+
+Bounds = Tuple[float, float, float, float, float, float]
+Plane = Tuple[float, float, float, float]
+
+
+def frustum_planes(matrix: mat4) -> List[Plane]:
+    """
+    Extracts the six clipping planes from a projection * view matrix.
+    """
+    rows = [(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]) for i in range(4)]
+    planes = []
+    for i in range(3):
+        planes.append(tuple(rows[3][j] + rows[i][j] for j in range(4)))
+        planes.append(tuple(rows[3][j] - rows[i][j] for j in range(4)))
+    return planes
+
+
+class _Cell:
+    __slots__ = ("x", "y", "z", "half", "parent", "octant", "children", "items", "count")
+
+    def __init__(self, x: float, y: float, z: float, half: float, parent: Optional[_Cell] = None, octant: int = 0):
+        self.x: float = x
+        self.y: float = y
+        self.z: float = z
+        self.half: float = half
+        self.parent: Optional[_Cell] = parent
+        self.octant: int = octant
+        self.children: Optional[List[Optional[_Cell]]] = None
+        self.items: Dict[object, Bounds] = {}
+        self.count: int = 0
+
+    def contains(self, x: float, y: float, z: float) -> bool:
+        return self.x - self.half <= x < self.x + self.half and self.y - self.half <= y < self.y + self.half \
+            and self.z - self.half <= z < self.z + self.half
+
+    def loose(self) -> Bounds:
+        loose = self.half * 2
+        return self.x - loose, self.y - loose, self.z - loose, self.x + loose, self.y + loose, self.z + loose
+
+
+class LooseOctree(Generic[T]):
+    """
+    A loose octree over the axis-aligned world bounds of its items, whose root grows to fit them.
+    """
+
+    def __init__(self, bounds: Callable[[T], Tuple[vec3, vec3]], size: float = 256.0, min_size: float = 32.0):
+        self._bounds: Callable[[T], Tuple[vec3, vec3]] = bounds
+        self._size: float = size
+        self._min_half: float = min_size / 2
+        self._root: _Cell = _Cell(0.0, 0.0, 0.0, size / 2)
+        self._cells: Dict[T, _Cell] = {}
+        self.version: int = 0
+
+    def __len__(self) -> int:
+        return len(self._cells)
+
+    def __contains__(self, item: T) -> bool:
+        return item in self._cells
+
+    def __iter__(self) -> Iterator[T]:
+        return iter(self._cells)
+
+    def clear(self) -> None:
+        self._root = _Cell(0.0, 0.0, 0.0, self._size / 2)
+        self._cells = {}
+        self.version += 1
+
+    def bounds(self, item: T) -> Bounds:
+        """
+        Returns the world bounds the item was last indexed with.
+        """
+        return self._cells[item].items[item]
+
+    def insert(self, item: T) -> None:
+        if item in self._cells:
+            self.update(item)
+        else:
+            self._place(item, self._read_bounds(item))
+
+    def remove(self, item: T) -> None:
+        cell = self._cells.pop(item, None)
+        if cell is None:
+            return
+        self.version += 1
+
+        del cell.items[item]
+        while cell is not None:
+            cell.count -= 1
+            if cell.count == 0 and cell.parent is not None:
+                cell.parent.children[cell.octant] = None
+            cell = cell.parent
+
+    def update(self, item: T) -> None:
+        cell = self._cells.get(item)
+        if cell is None:
+            return
+        self.version += 1
+
+        bounds = self._read_bounds(item)
+        x, y, z, radius = self._sphere(bounds)
+        deepest = radius > cell.half / 2 or cell.half / 2 < self._min_half
+        if cell.contains(x, y, z) and radius <= cell.half and deepest:
+            cell.items[item] = bounds
+        else:
+            self.remove(item)
+            self._place(item, bounds)
+
+    def query_box(self, min_point: vec3, max_point: vec3) -> List[T]:
+        qx0, qy0, qz0 = min_point.x, min_point.y, min_point.z
+        qx1, qy1, qz1 = max_point.x, max_point.y, max_point.z
+
+        def test(x0, y0, z0, x1, y1, z1) -> bool:
+            return x0 <= qx1 and x1 >= qx0 and y0 <= qy1 and y1 >= qy0 and z0 <= qz1 and z1 >= qz0
+
+        return self._query(test)
+
+    def query_sphere(self, center: vec3, radius: float) -> List[T]:
+        cx, cy, cz = center.x, center.y, center.z
+        radius2 = radius * radius
+
+        def test(x0, y0, z0, x1, y1, z1) -> bool:
+            dx = x0 - cx if cx < x0 else (cx - x1 if cx > x1 else 0.0)
+            dy = y0 - cy if cy < y0 else (cy - y1 if cy > y1 else 0.0)
+            dz = z0 - cz if cz < z0 else (cz - z1 if cz > z1 else 0.0)
+            return dx * dx + dy * dy + dz * dz <= radius2
+
+        return self._query(test)
+
+    def query_frustum(self, matrix: mat4) -> List[T]:
+        planes = frustum_planes(matrix)
+
+        def test(x0, y0, z0, x1, y1, z1) -> bool:
+            for a, b, c, d in planes:
+                if a * (x1 if a >= 0 else x0) + b * (y1 if b >= 0 else y0) + c * (z1 if c >= 0 else z0) + d < 0:
+                    return False
+            return True
+
+        return self._query(test)
+
+    def query_ray(self, origin: vec3, direction: vec3, max_distance: float = math.inf) -> List[Tuple[float, T]]:
+        """
+        Returns (distance, item) for every item whose bounds the ray enters, nearest first.
+        """
+        origin = (origin.x, origin.y, origin.z)
+        inverse = tuple(1.0 / d if d != 0.0 else math.inf for d in (direction.x, direction.y, direction.z))
+
+        def enter(x0, y0, z0, x1, y1, z1) -> Optional[float]:
+            near, far = 0.0, max_distance
+            for o, inv, lo, hi in zip(origin, inverse, (x0, y0, z0), (x1, y1, z1)):
+                if inv == math.inf:
+                    if o < lo or o > hi:
+                        return None
+                    continue
+                t0, t1 = (lo - o) * inv, (hi - o) * inv
+                if t0 > t1:
+                    t0, t1 = t1, t0
+                near, far = max(near, t0), min(far, t1)
+                if near > far:
+                    return None
+            return near
+
+        hits = []
+        stack = [self._root]
+        while stack:
+            cell = stack.pop()
+            if enter(*cell.loose()) is None:
+                continue
+            for item, bounds in cell.items.items():
+                distance = enter(*bounds)
+                if distance is not None:
+                    hits.append((distance, item))
+            if cell.children is not None:
+                stack.extend(child for child in cell.children if child is not None)
+
+        hits.sort(key=lambda hit: hit[0])
+        return hits
+
+    def _query(self, test: Callable[..., bool]) -> List[T]:
+        found = []
+        stack = [self._root]
+        while stack:
+            cell = stack.pop()
+            if not test(*cell.loose()):
+                continue
+            found.extend(item for item, bounds in cell.items.items() if test(*bounds))
+            if cell.children is not None:
+                stack.extend(child for child in cell.children if child is not None)
+        return found
+
+    def _read_bounds(self, item: T) -> Bounds:
+        min_point, max_point = self._bounds(item)
+        return min_point.x, min_point.y, min_point.z, max_point.x, max_point.y, max_point.z
+
+    @staticmethod
+    def _sphere(bounds: Bounds) -> Tuple[float, float, float, float]:
+        x0, y0, z0, x1, y1, z1 = bounds
+        radius = max(x1 - x0, y1 - y0, z1 - z0) / 2
+        return (x0 + x1) / 2, (y0 + y1) / 2, (z0 + z1) / 2, radius
+
+    def _place(self, item: T, bounds: Bounds) -> None:
+        x, y, z, radius = self._sphere(bounds)
+        while not self._root.contains(x, y, z) or radius > self._root.half:
+            self._grow(x, y, z)
+
+        cell = self._root
+        cell.count += 1
+        while cell.half / 2 >= radius and cell.half / 2 >= self._min_half:
+            octant = (x >= cell.x) | (y >= cell.y) << 1 | (z >= cell.z) << 2
+            if cell.children is None:
+                cell.children = [None] * 8
+            if cell.children[octant] is None:
+                quarter = cell.half / 2
+                cell.children[octant] = _Cell(cell.x + (quarter if octant & 1 else -quarter),
+                                              cell.y + (quarter if octant & 2 else -quarter),
+                                              cell.z + (quarter if octant & 4 else -quarter), quarter, cell, octant)
+            cell = cell.children[octant]
+            cell.count += 1
+
+        cell.items[item] = bounds
+        self._cells[item] = cell
+        self.version += 1
+
+    def _grow(self, x: float, y: float, z: float) -> None:
+        old = self._root
+        half = old.half
+        root = _Cell(old.x + (half if x >= old.x else -half), old.y + (half if y >= old.y else -half),
+                     old.z + (half if z >= old.z else -half), half * 2)
+        root.count = old.count
+        if old.count > 0:
+            old.parent = root
+            old.octant = (old.x >= root.x) | (old.y >= root.y) << 1 | (old.z >= root.z) << 2
+            root.children = [None] * 8
+            root.children[old.octant] = old
+        self._root = root
@@ -0,0 +1,150 @@
+from __future__ import annotations
+
+import time
+from collections import deque
+from typing import Any, Deque, Dict, List, Optional, Tuple
+
+import numpy
+from OpenGL.GL import glGetQueryObjectiv, glGetQueryObjectui64v
+from OpenGL.raw.GL.VERSION.GL_1_5 import glBeginQuery, glEndQuery, GL_QUERY_RESULT, GL_QUERY_RESULT_AVAILABLE
+from OpenGL.raw.GL.VERSION.GL_3_3 import GL_TIME_ELAPSED
+
+from pykotor.gl.resources import GLResources, QUERY
+
+COUNTERS = ["draws", "triangles", "texture_binds", "program_switches", "culled", "texture_hits", "texture_misses",
+            "model_hits", "model_misses"]
+
+
+class FrameStats:
+    """
+    The CPU and GPU seconds per pass and the counters of one call to Scene.render().
+    """
+
+    __slots__ = ["cpu", "gpu", *COUNTERS]
+
+    def __init__(self):
+        self.cpu: Dict[str, float] = {}
+        self.gpu: Dict[str, float] = {}
+        self.draws: int = 0
+        self.triangles: int = 0
+        self.texture_binds: int = 0
+        self.program_switches: int = 0
+        self.culled: int = 0
+        self.texture_hits: int = 0
+        self.texture_misses: int = 0
+        self.model_hits: int = 0
+        self.model_misses: int = 0
+
+    def add_draw(self, elements: int, instances: int = 1) -> None:
+        self.draws += 1
+        self.triangles += elements // 3 * instances
+
+
+class RenderStats:
+    """
+    Keeps FrameStats for the last frames rendered by a scene.
+    """
+
+    def __init__(self, resources: GLResources, owner: Any, history: int = 120, gpu_timers: bool = True):
+        # The queries are tracked in resources and belong to the GL context of owner, the scene being timed
+        self.resources: GLResources = resources
+        self.owner: Any = owner
+        self.enabled: bool = True
+        self.gpu_timers: bool = gpu_timers
+        self.frames: Deque[FrameStats] = deque(maxlen=history)
+        self.frame: FrameStats = FrameStats()
+        self._frame_start: float = 0.0
+        self._pass: Optional[str] = None
+        self._pass_start: float = 0.0
+        self._pass_query: bool = False
+        self._free_queries: List[int] = []
+        self._frame_queries: List[Tuple[str, int]] = []
+        self._pending: Deque[Tuple[FrameStats, List[Tuple[str, int]]]] = deque()
+
+    def begin_frame(self) -> None:
+        self.frame = FrameStats()
+        if self.enabled:
+            self._collect()
+            self._frame_start = time.perf_counter()
+
+    def end_frame(self) -> None:
+        if self.enabled:
+            self.frame.cpu["frame"] = time.perf_counter() - self._frame_start
+            self.frames.append(self.frame)
+            if self._frame_queries:
+                self._pending.append((self.frame, self._frame_queries))
+                self._frame_queries = []
+        # Anything counted outside render(), such as picking, goes to a frame that is never recorded
+        self.frame = FrameStats()
+
+    def begin_pass(self, name: str) -> None:
+        if not self.enabled:
+            return
+        self._pass = name
+        self._pass_query = self.gpu_timers
+        if self._pass_query:
+            if not self._free_queries:
+                self._free_queries.extend(self.resources.queries(16, self.owner))
+            query = self._free_queries.pop()
+            glBeginQuery(GL_TIME_ELAPSED, query)
+            self._frame_queries.append((name, query))
+        self._pass_start = time.perf_counter()
+
+    def end_pass(self) -> None:
+        if self._pass is None:
+            return
+        if self._pass_query:
+            glEndQuery(GL_TIME_ELAPSED)
+        self.frame.cpu[self._pass] = self.frame.cpu.get(self._pass, 0.0) + time.perf_counter() - self._pass_start
+        self._pass = None
+
+    def _collect(self) -> None:
+        while self._pending:
+            frame, queries = self._pending[0]
+            if not int(numpy.atleast_1d(glGetQueryObjectiv(queries[-1][1], GL_QUERY_RESULT_AVAILABLE))[0]):
+                break
+            self._pending.popleft()
+            for name, query in queries:
+                elapsed = int(numpy.atleast_1d(glGetQueryObjectui64v(query, GL_QUERY_RESULT))[0])
+                frame.gpu[name] = frame.gpu.get(name, 0.0) + elapsed / 1e9
+                self._free_queries.append(query)
+
+    def summary(self) -> Dict[str, Dict[str, float]]:
+        """
+        Averages the recorded frames.
+        """
+        if self._pending:
+            self._collect()
+        frames = list(self.frames)
+        if not frames:
+            return {"cpu": {}, "gpu": {}, "counters": {}, "cache": {}}
+
+        def mean_ms(times: List[Dict[str, float]]) -> Dict[str, float]:
+            names = {name for frame_times in times for name in frame_times}
+            return {name: sum(frame_times.get(name, 0.0) for frame_times in times) / len(times) * 1000
+                    for name in sorted(names)}
+
+        timed = [frame.gpu for frame in frames if frame.gpu]
+        counters = {name: sum(getattr(frame, name) for frame in frames) / len(frames) for name in COUNTERS}
+        texture_lookups = counters["texture_hits"] + counters["texture_misses"]
+        model_lookups = counters["model_hits"] + counters["model_misses"]
+        return {
+            "cpu": mean_ms([frame.cpu for frame in frames]),
+            "gpu": mean_ms(timed) if timed else {},
+            "counters": counters,
+            "cache": {
+                "texture_hit_rate": counters["texture_hits"] / texture_lookups if texture_lookups else 1.0,
+                "model_hit_rate": counters["model_hits"] / model_lookups if model_lookups else 1.0,
+            },
+        }
+
+    def clear(self) -> None:
+        self.frames.clear()
+
+    def release(self) -> None:
+        queries = self._free_queries + [query for _, queries in self._pending for query in queries]
+        queries += [query for _, query in self._frame_queries]
+        for query in queries:
+            self.resources.release(QUERY, query, self.owner)
+        self._free_queries, self._frame_queries = [], []
+        self._pending.clear()
@@ -0,0 +1,213 @@
+"""
+Generated modules for testing the scene at sizes real modules never reach. A SyntheticModule provides the parts of the
+Module interface Scene reads, backed by an in-memory LYT, GIT, UTC/UTP/UTD blueprints and model data, so it can be
+rendered without an Installation:
+
+    module = SyntheticModule(rooms=50, placeables=5000, creatures=500, triggers=100, waypoints=1000)
+    scene = context.scene()
+    module.attach(scene)
+    scene.render()
+
+Models are the predefined gizmo models under generated names, one per room and one per placeable, door and creature
+appearance, so every name is a separate model in the scene's cache. Their meshes only use the NULL texture; TPCs put
+in textures are served by texture() for measuring texture loading. With vis_range, every room sees the rooms within
+that many steps of it on the grid, as interior modules do.
+"""
+from __future__ import annotations
+
+import math
+import random
+from typing import Any, Dict, List, Optional, Tuple
+
+from pykotor.common.geometry import Vector3
+from pykotor.common.misc import ResRef
+from pykotor.resource.formats.lyt import LYT, LYTRoom
+from pykotor.resource.formats.tpc import TPC
+from pykotor.resource.formats.twoda import TwoDA
+from pykotor.resource.formats.vis import VIS
+from pykotor.resource.generics.git import GIT, GITCreature, GITDoor, GITPlaceable, GITTrigger, GITWaypoint
+from pykotor.resource.generics.utc import UTC
+from pykotor.resource.generics.utd import UTD
+from pykotor.resource.generics.utp import UTP
+
+from pykotor.gl.models import predefined_mdl
+
+from typing import TYPE_CHECKING
+if TYPE_CHECKING:
+    from pykotor.gl.scene import Scene
+
+# Gizmo models reused as the geometry of generated models, largest last
+SOURCE_MODELS = ["unknown", "entry", "store", "camera", "trigger", "encounter", "sound", "waypoint"]
+ROOM_SIZE = 40.0
+
+
+class SyntheticResource:
+    """
+    Stands in for a ModuleResource.
+    """
+
+    def __init__(self, resource: Any = None, data: bytes = b""):
+        self._resource: Any = resource
+        self._data: bytes = data
+
+    def resource(self) -> Any:
+        return self._resource
+
+    def data(self) -> bytes:
+        return self._data
+
+
+class SyntheticModule:
+    """
+    A module generated from counts of each kind of object, the same for the same counts and seed.
+    """
+
+    def __init__(self, *, rooms: int = 16, placeables: int = 0, creatures: int = 0, doors: int = 0,
+                 triggers: int = 0, waypoints: int = 0, appearances: int = 8, vis_range: int = 0, seed: int = 0):
+        rng = random.Random(seed)
+        self._models: Dict[str, Tuple[bytes, bytes]] = {}
+        self._blueprints: Dict[str, Any] = {}
+        self.textures: Dict[str, TPC] = {}
+
+        self._layout: LYT = LYT()
+        side = max(1, math.ceil(math.sqrt(rooms)))
+        for i in range(rooms):
+            name = "syn_room_{}".format(i)
+            self._add_model(name, SOURCE_MODELS[i % len(SOURCE_MODELS)])
+            self._layout.rooms.append(LYTRoom(name, Vector3(i % side * ROOM_SIZE, i // side * ROOM_SIZE, 0.0)))
+
+        self._vis: Optional[VIS] = None
+        if vis_range > 0:
+            self._vis = VIS()
+            for i in range(rooms):
+                self._vis.add_room("syn_room_{}".format(i))
+            for i in range(rooms):
+                for j in range(rooms):
+                    if i != j and max(abs(i % side - j % side), abs(i // side - j // side)) <= vis_range:
+                        self._vis.set_visible("syn_room_{}".format(i), "syn_room_{}".format(j), True)
+
+        self.table_placeables: TwoDA = self._appearance_table("placeable", appearances, "modelname")
+        self.table_doors: TwoDA = self._appearance_table("door", appearances, "modelname")
+        # Full body models with no separate head, so creature.get_body_model() needs nothing from an installation
+        self.table_creatures: TwoDA = self._appearance_table("creature", appearances, "race", modeltype="F", racetex="",
+                                                             normalhead="", backuphead="")
+
+        def point() -> Tuple[float, float, float]:
+            if rooms == 0:
+                return rng.uniform(0, ROOM_SIZE), rng.uniform(0, ROOM_SIZE), 0.0
+            room = self._layout.rooms[rng.randrange(rooms)].position
+            return room.x + rng.uniform(-ROOM_SIZE / 2, ROOM_SIZE / 2), \
+                room.y + rng.uniform(-ROOM_SIZE / 2, ROOM_SIZE / 2), room.z
+
+        self._git: GIT = GIT()
+        for i in range(placeables):
+            self._git.placeables.append(self._instance(GITPlaceable, UTP, "syn_plc_{}".format(i % appearances),
+                                                       i % appearances, point(), rng))
+        for i in range(doors):
+            self._git.doors.append(self._instance(GITDoor, UTD, "syn_door_{}".format(i % appearances),
+                                                  i % appearances, point(), rng))
+        for i in range(creatures):
+            self._git.creatures.append(self._instance(GITCreature, UTC, "syn_crt_{}".format(i % appearances),
+                                                      i % appearances, point(), rng))
+        for i in range(waypoints):
+            self._git.waypoints.append(GITWaypoint(*point()))
+        for i in range(triggers):
+            trigger = GITTrigger(*point())
+            size = rng.uniform(1.0, 8.0)
+            for corner in [(-size, -size), (size, -size), (size, size), (-size, size)]:
+                trigger.geometry.points.append(Vector3(corner[0], corner[1], 0.0))
+            self._git.triggers.append(trigger)
+
+    @classmethod
+    def scaled(cls, objects: int, seed: int = 0, vis_range: int = 0) -> SyntheticModule:
+        """
+        Returns a module with about the given number of objects, split between the kinds like the game's modules.
+        """
+        return cls(rooms=max(1, objects // 50), placeables=objects * 4 // 10, creatures=objects // 10,
+                   doors=objects // 20, triggers=objects // 20, waypoints=objects * 3 // 10, vis_range=vis_range,
+                   seed=seed)
+
+    def _add_model(self, name: str, source: str) -> None:
+        self._models[name] = (getattr(predefined_mdl, source.upper() + "_MDL_DATA"),
+                              getattr(predefined_mdl, source.upper() + "_MDX_DATA"))
+
+    def _appearance_table(self, kind: str, appearances: int, column: str, **columns: str) -> TwoDA:
+        table = TwoDA()
+        for header in [column, *columns]:
+            table.add_column(header)
+        for row in range(appearances):
+            name = "syn_{}_{}".format(kind, row)
+            self._add_model(name, SOURCE_MODELS[row % len(SOURCE_MODELS)])
+            table.add_row(str(row), {column: name, **columns})
+        return table
+
+    def _instance(self, instance_type: type, blueprint_type: type, resref: str, appearance: int,
+                  position: Tuple[float, float, float], rng: random.Random) -> Any:
+        if resref not in self._blueprints:
+            blueprint = blueprint_type()
+            blueprint.appearance_id = appearance
+            self._blueprints[resref] = blueprint
+        instance = instance_type(*position)
+        instance.resref = ResRef(resref)
+        instance.bearing = rng.uniform(0, math.tau)
+        return instance
+
+    def attach(self, scene: Scene) -> None:
+        """
+        Gives the scene the generated 2DA tables and switches it to this module.
+        """
+        scene.table_placeables = self.table_placeables
+        scene.table_doors = self.table_doors
+        scene.table_creatures = self.table_creatures
+        scene.setModule(self)
+
+    def object_count(self) -> int:
+        return len(self._layout.rooms) + len(self._git.placeables) + len(self._git.creatures) \
+            + len(self._git.doors) + len(self._git.triggers) + len(self._git.waypoints)
+
+    def git(self) -> SyntheticResource:
+        return SyntheticResource(self._git)
+
+    def layout(self) -> SyntheticResource:
+        return SyntheticResource(self._layout)
+
+    def vis(self) -> SyntheticResource:
+        return SyntheticResource(self._vis)
+
+    def info(self) -> SyntheticResource:
+        return SyntheticResource(_EntryPoint(self._layout))
+
+    def capsules(self) -> List:
+        return []
+
+    def placeable(self, resref: str) -> Optional[SyntheticResource]:
+        return self._blueprint(resref)
+
+    def door(self, resref: str) -> Optional[SyntheticResource]:
+        return self._blueprint(resref)
+
+    def creature(self, resref: str) -> Optional[SyntheticResource]:
+        return self._blueprint(resref)
+
+    def sound(self, resref: str) -> Optional[SyntheticResource]:
+        return None
+
+    def texture(self, resname: str) -> Optional[SyntheticResource]:
+        tpc = self.textures.get(resname.lower())
+        return SyntheticResource(tpc) if tpc is not None else None
+
+    def model(self, resname: str) -> Optional[SyntheticResource]:
+        return SyntheticResource(data=self._models[resname.lower()][0]) if resname.lower() in self._models else None
+
+    def model_ext(self, resname: str) -> Optional[SyntheticResource]:
+        return SyntheticResource(data=self._models[resname.lower()][1]) if resname.lower() in self._models else None
+
+    def _blueprint(self, resref: str) -> Optional[SyntheticResource]:
+        blueprint = self._blueprints.get(str(resref).lower())
+        return SyntheticResource(blueprint) if blueprint is not None else None
+
+
+class _EntryPoint:
+    def __init__(self, layout: LYT):
+        position = layout.rooms[0].position if layout.rooms else Vector3(0.0, 0.0, 0.0)
+        self.entry_position: Vector3 = Vector3(position.x, position.y, position.z)
@@ -0,0 +1,153 @@
+from __future__ import annotations
+
+from typing import Dict, List, Optional, Tuple
+
+from OpenGL.raw.GL.EXT.texture_compression_s3tc import GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+from OpenGL.raw.GL.VERSION.GL_1_0 import glTexParameteri, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T, GL_TEXTURE_MIN_FILTER, \
+    GL_TEXTURE_MAG_FILTER, GL_REPEAT, GL_LINEAR, GL_NEAREST_MIPMAP_LINEAR
+from OpenGL.raw.GL.VERSION.GL_1_1 import glBindTexture
+from OpenGL.raw.GL.VERSION.GL_1_2 import GL_TEXTURE_MAX_LEVEL
+from OpenGL.raw.GL.VERSION.GL_1_3 import glCompressedTexImage3D, glCompressedTexSubImage3D
+from OpenGL.raw.GL.VERSION.GL_3_0 import GL_TEXTURE_2D_ARRAY
+from pykotor.resource.formats.tpc import TPC, TPCTextureFormat
+
+from pykotor.gl.resources import GLResources, TEXTURE
+from pykotor.gl.shader import Texture
+
+ARRAY_FORMATS = {
+    TPCTextureFormat.DXT1: GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+    TPCTextureFormat.DXT5: GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+}
+
+
+class TextureArray:
+    """
+    A GL_TEXTURE_2D_ARRAY with a fixed number of layers, all sharing one size, compressed format and mip chain.
+    """
+
+    def __init__(self, resources: GLResources, width: int, height: int, gl_format: int, level_sizes: List[int],
+                 capacity: int):
+        self._resources: GLResources = resources
+        self.width: int = width
+        self.height: int = height
+        self.capacity: int = capacity
+        # Layers in use
+        self.count: int = 0
+        # Bytes of one layer with its mip chain, and of the whole array
+        self.layer_size: int = sum(level_sizes)
+        self.size: int = self.layer_size * capacity
+        self._format: int = gl_format
+        self._levels: int = len(level_sizes)
+        self._free: List[int] = []
+        # Layers below this have been handed out at least once
+        self._end: int = 0
+
+        self._id = resources.texture(self.size)
+        glBindTexture(GL_TEXTURE_2D_ARRAY, self._id)
+        for level, size in enumerate(level_sizes):
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, gl_format, max(1, width >> level),
+                                   max(1, height >> level), capacity, 0, size * capacity, None)
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, self._levels - 1)
+
+    def id(self) -> int:
+        return self._id
+
+    def full(self) -> bool:
+        return self.count >= self.capacity
+
+    def add(self, tpc: TPC) -> Texture:
+        if self._free:
+            layer = self._free.pop()
+        else:
+            layer = self._end
+            self._end += 1
+        self.count += 1
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, self._id)
+        for level in range(self._levels):
+            width, height, tpc_format, data = tpc.get(level)
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, self._format,
+                                      len(data), data)
+
+        return Texture(self._id, GL_TEXTURE_2D_ARRAY, layer, self.layer_size)
+
+    def remove(self, layer: int) -> None:
+        self._free.append(layer)
+        self.count -= 1
+
+    def release(self) -> None:
+        self._resources.release(TEXTURE, self._id)
+
+
+class TextureArrayManager:
+    """
+    Packs DXT1/DXT5 textures of the same size and mip chain into shared texture arrays.
+    """
+
+    def __init__(self, resources: GLResources, max_layers: int = 64, min_layers: int = 4):
+        self.resources: GLResources = resources
+        self.max_layers: int = max_layers
+        self.min_layers: int = min_layers
+        self._arrays: Dict[Tuple[int, int, TPCTextureFormat, int], List[TextureArray]] = {}
+        self._by_id: Dict[int, Tuple[Tuple[int, int, TPCTextureFormat, int], TextureArray]] = {}
+
+    def pack(self, tpc: TPC) -> Optional[Texture]:
+        """
+        Uploads the TPC into a layer of a texture array and returns its handle, or None if it cannot be packed.
+        """
+        width, height, tpc_format, data = tpc.get(0)
+        if tpc_format not in ARRAY_FORMATS or width < 4 or height < 4 or width & (width - 1) or height & (height - 1):
+            return None
+
+        level_sizes = []
+        for level in range(tpc.mipmap_count()):
+            level_width, level_height, level_format, level_data = tpc.get(level)
+            if level_width != max(1, width >> level) or level_height != max(1, height >> level):
+                return None
+            level_sizes.append(len(level_data))
+
+        key = (width, height, tpc_format, len(level_sizes))
+        arrays = self._arrays.setdefault(key, [])
+        array = next((array for array in arrays if not array.full()), None)
+        if array is None:
+            capacity = min(self.max_layers, max(array.capacity for array in arrays) * 2) if arrays \
+                else self.min_layers
+            array = TextureArray(self.resources, width, height, ARRAY_FORMATS[tpc_format], level_sizes, capacity)
+            arrays.append(array)
+            self._by_id[array.id()] = (key, array)
+        return array.add(tpc)
+
+    def free(self, texture: Texture) -> int:
+        """
+        Gives the layer of a packed texture back and returns its bytes.
+        """
+        found = self._by_id.get(texture.id())
+        if found is None:
+            return 0
+        key, array = found
+        array.remove(texture.layer)
+        if array.count == 0:
+            self._arrays[key].remove(array)
+            del self._by_id[array.id()]
+            array.release()
+        return array.layer_size
+
+    def arrays(self) -> List[TextureArray]:
+        return [array for arrays in self._arrays.values() for array in arrays]
+
+    def size(self) -> int:
+        return sum(array.size for array in self.arrays())
+
+    def release(self) -> None:
+        """
+        Deletes every array.
+        """
+        for array in self.arrays():
+            array.release()
+        self._arrays.clear()
+        self._by_id.clear()
@@ -0,0 +1,54 @@
+from __future__ import annotations
+
+import time
+from concurrent.futures import Future, ThreadPoolExecutor
+from typing import TYPE_CHECKING, Any, Callable, Dict, Iterator, Optional, Tuple
+
+if TYPE_CHECKING:
+    from pykotor.resource.formats.tpc import TPC
+
+    from pykotor.gl.shader import Texture
+
+
+class TextureLoader:
+    """
+    Loads TPCs for texture handles on worker threads, for the render loop to upload once they are done.
+    """
+
+    def __init__(self, pending: Dict[Texture, Future], workers: int):
+        self.pending: Dict[Texture, Future] = pending
+        self._workers: Optional[ThreadPoolExecutor] = ThreadPoolExecutor(workers, "texture") if workers > 0 else None
+
+    def asynchronous(self) -> bool:
+        return self._workers is not None
+
+    def submit(self, function: Callable, *args: Any) -> Future:
+        """
+        Runs other loading work of the scene on the same workers.
+        """
+        return self._workers.submit(function, *args)
+
+    def request(self, texture: Texture, load: Callable[..., Optional[TPC]], *args: Any) -> None:
+        self.pending[texture] = self._workers.submit(load, *args)
+
+    def finished(self, deadline: Optional[float] = None) -> Iterator[Tuple[Texture, Optional[TPC]]]:
+        """
+        Yields the finished loads with their TPCs until the deadline passes, or waits for every load without one.
+        """
+        for texture, future in list(self.pending.items()):
+            if deadline is not None and time.perf_counter() > deadline:
+                break
+            if deadline is not None and not future.done():
+                continue
+            if self.pending.pop(texture, None) is not None:
+                yield texture, future.result()
+
+    def cancel(self, texture: Texture) -> None:
+        future = self.pending.pop(texture, None)
+        if future is not None:
+            future.cancel()
+
+    def shutdown(self) -> None:
+        if self._workers is not None:
+            self._workers.shutdown(wait=False)
+            self._workers = None
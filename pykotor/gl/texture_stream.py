@@ -0,0 +1,64 @@
+from __future__ import annotations
+
+from collections import deque
+from typing import Deque, Optional, Tuple
+
+from pykotor.resource.formats.tpc import TPC
+
+from pykotor.gl.buffer import PixelUploadRing
+from pykotor.gl.shader import Texture
+
+
+class TextureStreamer:
+    """
+    Uploads the large mip levels of textures a few at a time, smallest first.
+    """
+
+    def __init__(self, budget: int = 4 << 20, initial_size: int = 128):
+        self.budget: int = budget
+        self.initial_size: int = initial_size
+        # Entries hold their own Texture instance, so a scene handle that gets replaced does not redirect the upload
+        self._queue: Deque[Tuple[Texture, TPC, int]] = deque()
+
+    def __len__(self) -> int:
+        return len(self._queue)
+
+    def load(self, tpc: TPC, pixels: Optional[PixelUploadRing] = None) -> Texture:
+        base_level = 0
+        for level in range(tpc.mipmap_count()):
+            width, height, tpc_format, data = tpc.get(level)
+            base_level = level
+            if max(width, height) <= self.initial_size:
+                break
+
+        texture = Texture.from_tpc(tpc, base_level, pixels)
+        if base_level > 0:
+            self._queue.append((Texture(texture.id()), tpc, base_level))
+        return texture
+
+    def cancel(self, texture_id: int) -> None:
+        """
+        Drops the queued levels of a texture.
+        """
+        self._queue = deque(entry for entry in self._queue if entry[0].id() != texture_id)
+
+    def upload(self, pixels: Optional[PixelUploadRing] = None) -> int:
+        """
+        Uploads queued mip levels until the budget is spent and returns the number of bytes uploaded.
+        """
+        uploaded = 0
+        while self._queue and (uploaded == 0 or uploaded < self.budget):
+            texture, tpc, base_level = self._queue.popleft()
+            uploaded += texture.upload_level(tpc, base_level - 1, pixels)
+            if base_level > 1:
+                self._queue.append((texture, tpc, base_level - 1))
+        return uploaded
+
+    def finish(self) -> int:
+        """
+        Uploads everything still queued, regardless of the budget.
+        """
+        uploaded = 0
+        while self._queue:
+            uploaded += self.upload()
+        return uploaded
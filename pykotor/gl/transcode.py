@@ -0,0 +1,244 @@
+from __future__ import annotations
+
+import hashlib
+import os
+import struct
+import tempfile
+from typing import List, Optional, Tuple, Union
+
+import numpy
+from pykotor.resource.formats.tpc import TPC, TPCTextureFormat
+
+CACHE_MAGIC = b"BCN1"
+
+
+class CompressedTPC:
+    """
+    A DXT1/DXT5 mip chain that can be uploaded in place of the TPC it was made from.
+    """
+
+    def __init__(self, width: int, height: int, texture_format: TPCTextureFormat, mipmaps: List[bytes]):
+        self.width: int = width
+        self.height: int = height
+        self.format: TPCTextureFormat = texture_format
+        self.mipmaps: List[bytes] = mipmaps
+
+    def get(self, mipmap: int = 0) -> Tuple[int, int, TPCTextureFormat, bytes]:
+        return max(1, self.width >> mipmap), max(1, self.height >> mipmap), self.format, self.mipmaps[mipmap]
+
+    def mipmap_count(self) -> int:
+        return len(self.mipmaps)
+
+
+class TextureTranscoder:
+    """
+    Compresses uncompressed textures to DXT1 or DXT5 on the CPU, caching the results in cache_dir.
+    """
+
+    def __init__(self, cache_dir: Optional[str] = None):
+        self.cache_dir: str = cache_dir if cache_dir is not None else \
+            os.path.join(os.path.expanduser("~"), ".cache", "pykotor", "bcn")
+
+    def transcode(self, tpc: TPC) -> Union[TPC, CompressedTPC]:
+        """
+        Returns a compressed copy of the texture, or the texture itself if it is already compressed or empty.
+        """
+        width, height, tpc_format, data = tpc.get(0)
+        if tpc_format not in (TPCTextureFormat.RGB, TPCTextureFormat.RGBA) or width == 0 or height == 0:
+            return tpc
+
+        channels = 3 if tpc_format == TPCTextureFormat.RGB else 4
+        levels = []
+        for level in range(tpc.mipmap_count()):
+            level_width, level_height, _, level_data = tpc.get(level)
+            if level_width != max(1, width >> level) or level_height != max(1, height >> level) \
+                    or len(level_data) != level_width * level_height * channels:
+                break
+            levels.append(bytes(level_data))
+        if not levels:
+            return tpc
+
+        digest = hashlib.sha1(struct.pack("<III", width, height, channels))
+        for level_data in levels:
+            digest.update(level_data)
+        path = os.path.join(self.cache_dir, digest.hexdigest() + ".bcn")
+
+        cached = self._read(path)
+        if cached is not None:
+            return cached
+
+        compressed = self._compress(width, height, channels, levels)
+        self._write(path, compressed)
+        return compressed
+
+    @staticmethod
+    def _compress(width: int, height: int, channels: int, levels: List[bytes]) -> CompressedTPC:
+        image = numpy.frombuffer(levels[0], numpy.uint8).reshape(height, width, channels)
+        encode = compress_dxt1 if channels == 3 else compress_dxt5
+
+        mipmaps = []
+        level = 0
+        while True:
+            mipmaps.append(encode(image))
+            if image.shape[0] == 1 and image.shape[1] == 1:
+                break
+            level += 1
+            if level < len(levels):
+                shape = (max(1, height >> level), max(1, width >> level), channels)
+                image = numpy.frombuffer(levels[level], numpy.uint8).reshape(shape)
+            else:
+                image = downsample(image)
+
+        texture_format = TPCTextureFormat.DXT1 if channels == 3 else TPCTextureFormat.DXT5
+        return CompressedTPC(width, height, texture_format, mipmaps)
+
+    @staticmethod
+    def _read(path: str) -> Optional[CompressedTPC]:
+        try:
+            with open(path, "rb") as file:
+                data = file.read()
+        except OSError:
+            return None
+
+        if data[:4] != CACHE_MAGIC:
+            return None
+        width, height, dxt5, count = struct.unpack_from("<IIII", data, 4)
+        offset = 20
+        mipmaps = []
+        for _ in range(count):
+            size, = struct.unpack_from("<I", data, offset)
+            mipmaps.append(data[offset + 4:offset + 4 + size])
+            offset += 4 + size
+        texture_format = TPCTextureFormat.DXT5 if dxt5 else TPCTextureFormat.DXT1
+        return CompressedTPC(width, height, texture_format, mipmaps)
+
+    def _write(self, path: str, texture: CompressedTPC) -> None:
+        # Written to a temporary file first, so other workers and processes never read a partial entry
+        try:
+            os.makedirs(self.cache_dir, exist_ok=True)
+            fd, temp_path = tempfile.mkstemp(dir=self.cache_dir, suffix=".tmp")
+            with os.fdopen(fd, "wb") as file:
+                file.write(CACHE_MAGIC)
+                file.write(struct.pack("<IIII", texture.width, texture.height,
+                                       texture.format == TPCTextureFormat.DXT5, len(texture.mipmaps)))
+                for mipmap in texture.mipmaps:
+                    file.write(struct.pack("<I", len(mipmap)))
+                    file.write(mipmap)
+            os.replace(temp_path, path)
+        except OSError:
+            pass
+
+
+def downsample(image: numpy.ndarray) -> numpy.ndarray:
+    """
+    Halves an image by averaging 2x2 pixels.
+    """
+    height, width = image.shape[:2]
+    if height % 2 and height > 1:
+        image = image[:-1]
+    if width % 2 and width > 1:
+        image = image[:, :-1]
+    pixels = image.astype(numpy.uint16)
+    if pixels.shape[0] > 1:
+        pixels = pixels[0::2] + pixels[1::2]
+    else:
+        pixels = pixels * 2
+    if pixels.shape[1] > 1:
+        pixels = pixels[:, 0::2] + pixels[:, 1::2]
+    else:
+        pixels = pixels * 2
+    return ((pixels + 2) // 4).astype(numpy.uint8)
+
+
+def _blocks(image: numpy.ndarray) -> numpy.ndarray:
+    height, width, channels = image.shape
+    padded_height, padded_width = (height + 3) // 4 * 4, (width + 3) // 4 * 4
+    if (padded_height, padded_width) != (height, width):
+        image = numpy.pad(image, ((0, padded_height - height), (0, padded_width - width), (0, 0)), mode="edge")
+    blocks = image.reshape(padded_height // 4, 4, padded_width // 4, 4, channels).transpose(0, 2, 1, 3, 4)
+    return blocks.reshape(padded_height // 4, padded_width // 4, 16, channels).astype(numpy.float32)
+
+
+def _pack_565(colors: numpy.ndarray) -> numpy.ndarray:
+    rgb = numpy.clip(numpy.rint(colors), 0, 255).astype(numpy.uint16)
+    return (rgb[..., 0] >> 3 << 11) | (rgb[..., 1] >> 2 << 5) | (rgb[..., 2] >> 3)
+
+
+def _unpack_565(packed: numpy.ndarray) -> numpy.ndarray:
+    r = (packed >> 11) & 0x1F
+    g = (packed >> 5) & 0x3F
+    b = packed & 0x1F
+    return numpy.stack([(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)], -1).astype(numpy.float32)
+
+
+def _color_blocks(pixels: numpy.ndarray) -> numpy.ndarray:
+    """
+    Encodes the RGB of each block as a DXT1 block with endpoints on the block's principal axis.
+    """
+    mean = pixels.mean(axis=2, keepdims=True)
+    centered = pixels - mean
+    covariance = numpy.einsum("...ni,...nj->...ij", centered, centered)
+
+    axis = numpy.ones(pixels.shape[:2] + (3,), numpy.float32)
+    for _ in range(8):
+        axis = numpy.einsum("...ij,...j->...i", covariance, axis)
+        axis /= numpy.maximum(numpy.linalg.norm(axis, axis=-1, keepdims=True), 1e-8)
+
+    projection = numpy.einsum("...ni,...i->...n", centered, axis)
+    low = mean[..., 0, :] + axis * projection.min(axis=-1, keepdims=True)
+    high = mean[..., 0, :] + axis * projection.max(axis=-1, keepdims=True)
+
+    color0, color1 = _pack_565(high), _pack_565(low)
+    # Four color mode requires color0 > color1
+    swap = color0 < color1
+    color0, color1 = numpy.where(swap, color1, color0), numpy.where(swap, color0, color1)
+
+    endpoint0, endpoint1 = _unpack_565(color0), _unpack_565(color1)
+    palette = numpy.stack([endpoint0, endpoint1, (2 * endpoint0 + endpoint1) / 3, (endpoint0 + 2 * endpoint1) / 3], -2)
+    distances = ((pixels[..., :, None, :] - palette[..., None, :, :]) ** 2).sum(axis=-1)
+    indices = distances.argmin(axis=-1).astype(numpy.uint32)
+    indices[color0 == color1] = 0
+
+    shifts = numpy.arange(16, dtype=numpy.uint32) * 2
+    packed_indices = numpy.bitwise_or.reduce(indices << shifts, axis=-1)
+
+    out = numpy.empty(pixels.shape[:2], numpy.dtype([("c0", "<u2"), ("c1", "<u2"), ("indices", "<u4")]))
+    out["c0"], out["c1"], out["indices"] = color0, color1, packed_indices
+    return out
+
+
+def _alpha_blocks(alpha: numpy.ndarray) -> numpy.ndarray:
+    alpha0 = alpha.max(axis=-1)
+    alpha1 = alpha.min(axis=-1)
+    weights = numpy.array([7, 0, 6, 5, 4, 3, 2, 1], numpy.float32) / 7
+    palette = numpy.floor(alpha0[..., None] * weights + alpha1[..., None] * (1 - weights) + 0.5)
+    indices = numpy.abs(alpha[..., :, None] - palette[..., None, :]).argmin(axis=-1).astype(numpy.uint64)
+    indices[alpha0 == alpha1] = 0
+
+    shifts = numpy.arange(16, dtype=numpy.uint64) * 3
+    packed_indices = numpy.bitwise_or.reduce(indices << shifts, axis=-1)
+
+    out = numpy.empty(alpha.shape[:2], numpy.dtype([("a0", "u1"), ("a1", "u1"), ("indices", "<u2", 3)]))
+    out["a0"], out["a1"] = alpha0, alpha1
+    for i in range(3):
+        out["indices"][..., i] = (packed_indices >> numpy.uint64(16 * i)) & numpy.uint64(0xFFFF)
+    return out
+
+
+def compress_dxt1(image: numpy.ndarray) -> bytes:
+    """
+    Compresses an RGB image of shape (height, width, 3) to DXT1.
+    """
+    return _color_blocks(_blocks(image)).tobytes()
+
+
+def compress_dxt5(image: numpy.ndarray) -> bytes:
+    """
+    Compresses an RGBA image of shape (height, width, 4) to DXT5.
+    """
+    blocks = _blocks(image)
+    alpha = _alpha_blocks(blocks[..., 3])
+    color = _color_blocks(blocks[..., :3])
+    out = numpy.empty(alpha.shape, numpy.dtype([("alpha", alpha.dtype), ("color", color.dtype)]))
+    out["alpha"], out["color"] = alpha, color
+    return out.tobytes()
@@ -0,0 +1,75 @@
+from __future__ import annotations
+
+import math
+from typing import Any, Dict, Optional, Set
+
+from glm import vec3
+from pykotor.resource.formats.lyt import LYTRoom
+from pykotor.resource.formats.vis import VIS
+
+from pykotor.gl.spatial import LooseOctree
+
+
+class RoomVisibility:
+    """
+    Culls by the rooms of a module's VIS, found through the scene's spatial index.
+    """
+
+    def __init__(self, spatial: LooseOctree):
+        self.spatial: LooseOctree = spatial
+        self.vis: Optional[VIS] = None
+        # The rooms seen from each room, including itself, by lowercase model name; None until load() is called
+        self._rooms: Optional[Dict[str, Set[str]]] = None
+        self._object_rooms: Dict[Any, Optional[str]] = {}
+
+    def loaded(self) -> bool:
+        return self._rooms is not None
+
+    def load(self, vis: Optional[VIS]) -> None:
+        self.vis = vis
+        self._rooms = {}
+        if vis is not None:
+            for observer, observed in vis:
+                self._rooms[observer.lower()] = {room.lower() for room in observed} | {observer.lower()}
+
+    def unload(self) -> None:
+        self.vis = None
+        self._rooms = None
+
+    def forget(self, obj: Any) -> None:
+        self._object_rooms.pop(obj, None)
+
+    def forget_all(self) -> None:
+        self._object_rooms = {}
+
+    def room_at(self, point: vec3) -> Optional[str]:
+        """
+        Returns the model name of the smallest room containing the point, or None.
+        """
+        found = None
+        found_volume = math.inf
+        for obj in self.spatial.query_box(point, point):
+            if isinstance(obj.data, LYTRoom):
+                x0, y0, z0, x1, y1, z1 = self.spatial.bounds(obj)
+                if (x1 - x0) * (y1 - y0) * (z1 - z0) < found_volume:
+                    found = obj.data.model.lower()
+                    found_volume = (x1 - x0) * (y1 - y0) * (z1 - z0)
+        return found
+
+    def visible_rooms(self, point: vec3) -> Optional[Set[str]]:
+        """
+        Returns the rooms seen from the room the point is in, or None if nothing should be culled.
+        """
+        if not self._rooms:
+            return None
+        room = self.room_at(point)
+        return self._rooms.get(room) if room is not None else None
+
+    def culled(self, obj: Any, visible_rooms: Set[str]) -> bool:
+        if isinstance(obj.data, LYTRoom):
+            return obj.data.model.lower() not in visible_rooms
+
+        if obj not in self._object_rooms:
+            self._object_rooms[obj] = self.room_at(obj.position())
+        room = self._object_rooms[obj]
+        return room is not None and room not in visible_rooms
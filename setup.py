@@ -7,7 +7,7 @@ NAME = "PyKotorGL"
 VERSION = "1.2.2"
 AUTHOR = "Nicholas Hugi"
 DESCRIPTION = "Render modules from both KotOR games."
-PACKAGES = find_namespace_packages()
+PACKAGES = find_namespace_packages(include=["pykotor*"])
 URL = "https://github.com/NickHugi/PyKotorGL"
 
 README = (HERE / "README.rd").read_text()
@@ -21,5 +21,10 @@ setup(
     install_requires=REQUIREMENTS,
     long_description=README,
     packages=PACKAGES,
-    url=URL
+    url=URL,
+    entry_points={
+        "console_scripts": [
+            "pykotor-render-modules=pykotor.gl.render_modules:main"
+        ]
+    }
 )
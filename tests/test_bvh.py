@@ -0,0 +1,96 @@
+"""
+Checks the Möller–Trumbore batch test on hand-made cases and TriangleBVH against testing every triangle.
+"""
+from __future__ import annotations
+
+import math
+
+import numpy
+import pytest
+
+from pykotor.gl.bvh import LEAF_SIZE, TriangleBVH, intersect_triangles
+
+
+def _intersect(origin, direction, triangles) -> numpy.ndarray:
+    triangles = numpy.asarray(triangles, numpy.float64).reshape(-1, 3, 3)
+    return intersect_triangles(numpy.asarray(origin, numpy.float64), numpy.asarray(direction, numpy.float64),
+                               triangles[:, 0], triangles[:, 1] - triangles[:, 0], triangles[:, 2] - triangles[:, 0])
+
+
+def _random_triangles(rng: numpy.random.Generator, count: int) -> numpy.ndarray:
+    centers = rng.uniform(-50.0, 50.0, (count, 1, 3))
+    return centers + rng.uniform(-3.0, 3.0, (count, 3, 3))
+
+
+UNIT = [[0.0, 0.0, 0.0], [1.0, 0.0, 0.0], [0.0, 1.0, 0.0]]
+
+
+def test_hit_inside_triangle_gives_ray_parameter():
+    assert _intersect((0.25, 0.25, 5.0), (0.0, 0.0, -1.0), [UNIT])[0] == pytest.approx(5.0)
+    # The parameter is in multiples of the direction's length
+    assert _intersect((0.25, 0.25, 5.0), (0.0, 0.0, -2.0), [UNIT])[0] == pytest.approx(2.5)
+
+
+def test_both_faces_count():
+    assert _intersect((0.25, 0.25, -5.0), (0.0, 0.0, 1.0), [UNIT])[0] == pytest.approx(5.0)
+
+
+def test_misses():
+    distances = _intersect((0.75, 0.75, 5.0), (0.0, 0.0, -1.0), [UNIT])
+    assert math.isinf(distances[0])
+    # Behind the origin
+    assert math.isinf(_intersect((0.25, 0.25, 5.0), (0.0, 0.0, 1.0), [UNIT])[0])
+    # Parallel to the triangle
+    assert math.isinf(_intersect((0.25, 0.25, 0.0), (1.0, 0.0, 0.0), [UNIT])[0])
+
+
+def test_degenerate_triangles_never_hit():
+    line = [[0.0, 0.0, 0.0], [1.0, 0.0, 0.0], [2.0, 0.0, 0.0]]
+    assert math.isinf(_intersect((0.5, 0.0, 1.0), (0.0, 0.0, -1.0), [line])[0])
+
+
+@pytest.mark.parametrize("count", [0, 1, LEAF_SIZE, LEAF_SIZE + 1, 3000])
+def test_bvh_matches_brute_force(count):
+    rng = numpy.random.default_rng(count)
+    triangles = _random_triangles(rng, count)
+    bvh = TriangleBVH(triangles)
+    assert len(bvh) == count
+
+    for _ in range(200):
+        origin = rng.uniform(-80.0, 80.0, 3)
+        # Aim at a random triangle half of the time so that hits are common
+        target = triangles[rng.integers(count)].mean(axis=0) if count and rng.random() < 0.5 \
+            else rng.uniform(-50.0, 50.0, 3)
+        direction = target - origin
+
+        hit = bvh.intersect(tuple(origin), tuple(direction))
+        distances = _intersect(origin, direction, triangles) if count else numpy.array([numpy.inf])
+        nearest = float(distances.min())
+        if math.isinf(nearest):
+            assert hit is None
+        else:
+            assert hit is not None
+            assert hit[0] == pytest.approx(nearest)
+            assert distances[hit[1]] == pytest.approx(nearest)
+
+
+def test_bvh_respects_max_distance():
+    bvh = TriangleBVH(numpy.array([UNIT]))
+    assert bvh.intersect((0.25, 0.25, 5.0), (0.0, 0.0, -1.0), 4.0) is None
+    assert bvh.intersect((0.25, 0.25, 5.0), (0.0, 0.0, -1.0), 6.0) == (pytest.approx(5.0), 0)
+
+
+def test_axis_aligned_rays():
+    rng = numpy.random.default_rng(11)
+    triangles = _random_triangles(rng, 500)
+    bvh = TriangleBVH(triangles)
+    for axis in range(3):
+        for _ in range(50):
+            origin = rng.uniform(-60.0, 60.0, 3)
+            direction = numpy.zeros(3)
+            direction[axis] = rng.choice([-1.0, 1.0])
+            hit = bvh.intersect(tuple(origin), tuple(direction))
+            nearest = float(_intersect(origin, direction, triangles).min())
+            assert (hit is None) == math.isinf(nearest)
+            if hit is not None:
+                assert hit[0] == pytest.approx(nearest)
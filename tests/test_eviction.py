@@ -0,0 +1,121 @@
+"""
+Checks that evict() brings a scene's textures and models within the budget, freeing the least recently drawn first,
+and that it stops once nothing left can be freed. Packed textures go through a stand-in texture array manager that,
+like TextureArrayManager, frees the layer's bytes and deletes an array with its last layer.
+"""
+from __future__ import annotations
+
+from typing import Dict, List
+
+from pykotor.gl.eviction import evict, vram_usage
+
+LAYER_SIZE = 1000
+
+
+class FakeTexture:
+    def __init__(self, size: int, last_used: int, layer: int = -1):
+        self.size = size
+        self.last_used = last_used
+        self.layer = layer
+
+
+class FakeModel:
+    def __init__(self, size: int, last_used: int):
+        self._size = size
+        self.last_used = last_used
+
+    def size(self) -> int:
+        return self._size
+
+
+class FakeTextureArrays:
+    def __init__(self, layers: int):
+        self.used = set(range(layers))
+        self.deleted = False
+
+    def free(self, texture: FakeTexture) -> int:
+        self.used.discard(texture.layer)
+        self.deleted = not self.used
+        return LAYER_SIZE
+
+
+class FakeScene:
+    """
+    Frees entries the way Scene does: textures are pointed at the blank texture, models are dropped.
+    """
+
+    def __init__(self, textures: Dict[str, FakeTexture], models: Dict[str, FakeModel], arrays: FakeTextureArrays):
+        self.textures = textures
+        self.models = models
+        self.arrays = arrays
+        self.freed: List[str] = []
+
+    def usage(self) -> int:
+        return vram_usage(self.textures.values(), self.models.values())
+
+    def free_texture(self, name: str) -> int:
+        texture = self.textures[name]
+        freed = self.arrays.free(texture) if texture.layer >= 0 else texture.size
+        texture.size, texture.layer = 0, -1
+        self.freed.append(name)
+        return freed
+
+    def free_model(self, name: str) -> int:
+        self.freed.append(name)
+        return self.models.pop(name).size()
+
+    def evict(self, budget: int, frame: int) -> int:
+        return evict(self.usage(), budget, frame, self.textures, dict(self.models), self.free_texture,
+                     self.free_model)
+
+
+def _scene() -> FakeScene:
+    arrays = FakeTextureArrays(4)
+    textures = {"packed_{}".format(layer): FakeTexture(LAYER_SIZE, layer + 1, layer) for layer in range(4)}
+    textures["plain"] = FakeTexture(4000, 2)
+    textures["blank"] = FakeTexture(0, 0)
+    models = {"old": FakeModel(3000, 0), "recent": FakeModel(2000, 9)}
+    return FakeScene(textures, models, arrays)
+
+
+def test_usage_counts_layers_not_arrays():
+    assert _scene().usage() == 4 * LAYER_SIZE + 4000 + 3000 + 2000
+
+
+def test_ends_within_budget_oldest_first():
+    scene = _scene()
+    left = scene.evict(6000, frame=10)
+    assert left == scene.usage() <= 6000
+    assert scene.freed == ["old", "packed_0", "packed_1", "plain"]
+
+
+def test_packed_textures_free_their_layers():
+    scene = _scene()
+    scene.textures = {name: texture for name, texture in scene.textures.items() if name.startswith("packed")}
+    scene.models = {}
+    assert scene.evict(0, frame=10) == 0
+    assert scene.arrays.deleted
+
+
+def test_entries_drawn_this_frame_are_kept():
+    scene = _scene()
+    for texture in scene.textures.values():
+        texture.last_used = 10
+    scene.models["old"].last_used = 10
+    left = scene.evict(0, frame=10)
+    # Only the model last drawn before this frame could go; the rest stays over budget
+    assert scene.freed == ["recent"]
+    assert left == scene.usage() == 4 * LAYER_SIZE + 4000 + 3000
+
+
+def test_stops_when_nothing_left_can_be_freed():
+    scene = FakeScene({"blank": FakeTexture(0, 0), "drawn": FakeTexture(5000, 10)}, {"empty": FakeModel(0, 0)},
+                      FakeTextureArrays(0))
+    assert scene.evict(0, frame=10) == 5000
+    assert scene.freed == []
+
+
+def test_within_budget_frees_nothing():
+    scene = _scene()
+    assert scene.evict(scene.usage(), frame=10) == scene.usage()
+    assert scene.freed == []
@@ -0,0 +1,89 @@
+"""
+Checks that ModelCache gives back what parse_stitched_model() returned, parses every model only once and treats
+damaged entries as misses.
+"""
+from __future__ import annotations
+
+import os
+
+import pytest
+
+for _module in ("glm", "OpenGL", "pykotor.common"):
+    pytest.importorskip(_module)
+from glm import quat, vec3
+
+from pykotor.gl import model_cache
+from pykotor.gl.model_cache import ModelCache
+from pykotor.gl.models.read_mdl import StitchedModelData
+
+
+def _model() -> StitchedModelData:
+    model = StitchedModelData()
+    model.hooks.append(("headhook", vec3(0.0, 0.25, 1.75), quat(0.5, 0.5, -0.5, 0.5)))
+    model.hooks.append(("rhand", vec3(-0.5, 0.0, 1.0), quat(1.0, 0.0, 0.0, 0.0)))
+    model.meshes.append(("c_texture", "NULL", bytes(range(64)), bytes(12), 0x0021))
+    model.meshes.append(("", "lm_room", b"\x00\xff" * 40, b"\x01\x00" * 6, 0x0005))
+    return model
+
+
+@pytest.fixture
+def parses(monkeypatch):
+    calls = []
+
+    def parse(mdl, mdx):
+        calls.append((mdl, mdx))
+        return _model()
+
+    monkeypatch.setattr(model_cache, "parse_stitched_model", parse)
+    return calls
+
+
+def _same(first: StitchedModelData, second: StitchedModelData) -> bool:
+    hooks = [(name, tuple(position), tuple(rotation)) for name, position, rotation in first.hooks]
+    return hooks == [(name, tuple(position), tuple(rotation)) for name, position, rotation in second.hooks] \
+        and first.meshes == second.meshes
+
+
+def test_round_trip_and_parse_once(tmp_path, parses):
+    first = ModelCache(str(tmp_path)).parse(b"mdl data", b"mdx data")
+    assert len(parses) == 1
+    assert len(os.listdir(tmp_path)) == 1
+
+    second = ModelCache(str(tmp_path)).parse(b"mdl data", b"mdx data")
+    assert len(parses) == 1
+    assert _same(first, second)
+    assert second.textures() == {"c_texture", "lm_room"}
+
+
+def test_different_data_is_a_different_entry(tmp_path, parses):
+    cache = ModelCache(str(tmp_path))
+    cache.parse(b"mdl", b"mdx")
+    # The same bytes split differently between MDL and MDX are another model
+    cache.parse(b"mdlm", b"dx")
+    cache.parse(b"mdl", b"other mdx")
+    assert len(parses) == 3
+    assert len(os.listdir(tmp_path)) == 3
+
+
+def test_damaged_entries_are_parsed_again(tmp_path, parses):
+    cache = ModelCache(str(tmp_path))
+    cache.parse(b"mdl", b"mdx")
+    path = os.path.join(tmp_path, os.listdir(tmp_path)[0])
+    with open(path, "rb") as file:
+        data = file.read()
+
+    for damaged in (data[:len(data) // 2], b"XXXX" + data[4:]):
+        with open(path, "wb") as file:
+            file.write(damaged)
+        assert _same(cache.parse(b"mdl", b"mdx"), _model())
+    assert len(parses) == 3
+
+
+def test_parse_errors_are_not_cached(tmp_path, monkeypatch):
+    def fail(mdl, mdx):
+        raise ValueError("not a model")
+
+    monkeypatch.setattr(model_cache, "parse_stitched_model", fail)
+    with pytest.raises(ValueError):
+        ModelCache(str(tmp_path)).parse(b"mdl", b"mdx")
+    assert not os.path.exists(tmp_path) or os.listdir(tmp_path) == []
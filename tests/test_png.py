@@ -0,0 +1,80 @@
+"""
+Parses what encode_png writes chunk by chunk, checking signature, header, CRCs and pixels after inflating.
+"""
+from __future__ import annotations
+
+import struct
+import zlib
+from typing import List, Tuple
+
+import numpy
+import pytest
+
+from pykotor.gl.png import encode_png, write_png
+
+SIGNATURE = b"\x89PNG\r\n\x1a\n"
+
+
+def _chunks(data: bytes) -> List[Tuple[bytes, bytes]]:
+    assert data[:8] == SIGNATURE
+    chunks, offset = [], 8
+    while offset < len(data):
+        length, = struct.unpack_from(">I", data, offset)
+        kind, body = data[offset + 4:offset + 8], data[offset + 8:offset + 8 + length]
+        crc, = struct.unpack_from(">I", data, offset + 8 + length)
+        assert crc == zlib.crc32(kind + body) & 0xFFFFFFFF
+        chunks.append((kind, body))
+        offset += 12 + length
+    assert offset == len(data)
+    return chunks
+
+
+def decode_png(data: bytes) -> numpy.ndarray:
+    """
+    Decodes the subset of PNG encode_png writes: 8 bit RGB or RGBA, no interlacing, every row with filter type 0.
+    """
+    chunks = _chunks(data)
+    assert [kind for kind, _ in chunks][0] == b"IHDR" and chunks[-1] == (b"IEND", b"")
+    width, height, depth, color_type, compression, filtering, interlace = struct.unpack(">IIBBBBB", chunks[0][1])
+    assert (depth, compression, filtering, interlace) == (8, 0, 0, 0)
+    channels = {2: 3, 6: 4}[color_type]
+
+    compressed = b"".join(body for kind, body in chunks if kind == b"IDAT")
+    rows = numpy.frombuffer(zlib.decompress(compressed), numpy.uint8).reshape(height, width * channels + 1)
+    assert not rows[:, 0].any()
+    return rows[:, 1:].reshape(height, width, channels)
+
+
+@pytest.mark.parametrize("channels", [3, 4])
+@pytest.mark.parametrize("height, width", [(1, 1), (7, 13), (64, 32)])
+def test_round_trip(height, width, channels):
+    pixels = numpy.random.default_rng(height * width).integers(0, 256, (height, width, channels), numpy.uint8)
+    assert numpy.array_equal(decode_png(encode_png(pixels)), pixels)
+
+
+def test_non_contiguous_input():
+    pixels = numpy.arange(8 * 6 * 4, dtype=numpy.uint8).reshape(8, 6, 4)
+    # Flipped rows, as read back from a framebuffer, are a view with negative strides
+    flipped = pixels[::-1]
+    assert numpy.array_equal(decode_png(encode_png(flipped)), flipped)
+    assert numpy.array_equal(decode_png(encode_png(pixels[:, :, :3])), pixels[:, :, :3])
+
+
+def test_compression_level_changes_size_not_pixels():
+    pixels = numpy.zeros((64, 64, 3), numpy.uint8)
+    pixels[::4] = 255
+    stored, packed = encode_png(pixels, 0), encode_png(pixels, 9)
+    assert len(packed) < len(stored)
+    assert numpy.array_equal(decode_png(stored), decode_png(packed))
+
+
+def test_rejects_other_channel_counts():
+    with pytest.raises(KeyError):
+        encode_png(numpy.zeros((2, 2, 2), numpy.uint8))
+
+
+def test_write_png(tmp_path):
+    pixels = numpy.full((3, 5, 4), 200, numpy.uint8)
+    path = tmp_path / "out.png"
+    write_png(str(path), pixels)
+    assert path.read_bytes() == encode_png(pixels)
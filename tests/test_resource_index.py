@@ -0,0 +1,207 @@
+"""
+Checks that ResourceIndex finds resources in the order Installation.resource() would, that it reuses its saved
+tables while the files behind them are unchanged, and that refresh() follows the override folder. The installation
+and capsules are stand-ins over a temporary directory.
+"""
+from __future__ import annotations
+
+import os
+from typing import List
+
+import pytest
+
+pytest.importorskip("pykotor.extract.installation")
+from pykotor.extract.installation import SearchLocation
+from pykotor.resource.type import ResourceType
+
+from pykotor.gl.resource_index import ResourceIndex
+
+
+class FakeResource:
+    def __init__(self, resname: str, restype: ResourceType, filepath: str, offset: int = 0, size: int = 0):
+        self._resname, self._restype, self._filepath = resname, restype, filepath
+        self._offset, self._size = offset, size
+
+    def resname(self) -> str:
+        return self._resname
+
+    def restype(self) -> ResourceType:
+        return self._restype
+
+    def filepath(self) -> str:
+        return self._filepath
+
+    def offset(self) -> int:
+        return self._offset
+
+    def size(self) -> int:
+        return self._size
+
+
+class FakeCapsule:
+    def __init__(self, path: str, resources: List[FakeResource]):
+        self._path = path
+        self._resources = resources
+
+    def path(self) -> str:
+        return self._path
+
+    def __iter__(self):
+        return iter(self._resources)
+
+
+class FakeInstallation:
+    """
+    A chitin.key, one BIF holding "ALPHA" and "BETA", and an override folder with a subfolder.
+    """
+
+    def __init__(self, root: str):
+        self.root = root
+        os.makedirs(os.path.join(root, "override", "sub"))
+        self.bif = os.path.join(root, "data.bif")
+        _write(self.bif, b"xxalphaBETA!")
+        _write(os.path.join(root, "chitin.key"), b"key")
+        self.chitin = [FakeResource("ALPHA", ResourceType.TPC, self.bif, 2, 5),
+                       FakeResource("beta", ResourceType.MDL, self.bif, 7, 5),
+                       FakeResource("alpha", ResourceType.TPC, self.bif, 0, 2)]
+        self.chitin_scans = 0
+
+    def path(self) -> str:
+        return self.root
+
+    def override_path(self) -> str:
+        return os.path.join(self.root, "override")
+
+    def chitin_resources(self) -> List[FakeResource]:
+        self.chitin_scans += 1
+        return self.chitin
+
+    def texturepack_resources(self, name: str) -> List[FakeResource]:
+        return []
+
+
+def _write(path: str, data: bytes) -> None:
+    with open(path, "wb") as file:
+        file.write(data)
+
+
+def _touch_directory(path: str) -> None:
+    # Directory times can be as coarse as a scheduler tick, so changes made in quick succession are made visible
+    stat = os.stat(path)
+    os.utime(path, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+
+
+@pytest.fixture
+def installation(tmp_path) -> FakeInstallation:
+    return FakeInstallation(str(tmp_path / "game"))
+
+
+@pytest.fixture
+def cache_dir(tmp_path) -> str:
+    return str(tmp_path / "cache")
+
+
+OVERRIDE_FIRST = [SearchLocation.CUSTOM_MODULES, SearchLocation.OVERRIDE, SearchLocation.CHITIN]
+
+
+def test_chitin_first_entry_wins_and_reads_its_slice(installation, cache_dir):
+    index = ResourceIndex(installation, cache_dir)
+    assert index.locate("Alpha", [ResourceType.TPC], OVERRIDE_FIRST) == (ResourceType.TPC, (installation.bif, 2, 5))
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"alpha"
+    assert index.data("beta", ResourceType.MDL, OVERRIDE_FIRST) == b"BETA!"
+    assert index.locate("gamma", [ResourceType.TPC], OVERRIDE_FIRST) is None
+
+
+def test_search_order(installation, cache_dir):
+    override = os.path.join(installation.override_path(), "alpha.tpc")
+    _write(override, b"override")
+    index = ResourceIndex(installation, cache_dir)
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"override"
+    assert index.data("alpha", ResourceType.TPC, [SearchLocation.CHITIN, SearchLocation.OVERRIDE]) == b"alpha"
+    # Locations that are not indexed are skipped rather than failing
+    assert index.data("alpha", ResourceType.TPC, [SearchLocation.MUSIC, SearchLocation.CHITIN]) == b"alpha"
+
+
+def test_every_type_is_tried_at_a_location_before_the_next(installation, cache_dir):
+    _write(os.path.join(installation.override_path(), "alpha.tga"), b"tga")
+    index = ResourceIndex(installation, cache_dir)
+    types = [ResourceType.TPC, ResourceType.TGA]
+    assert index.locate("alpha", types, OVERRIDE_FIRST)[0] == ResourceType.TGA
+    assert index.locate("alpha", types, [SearchLocation.CHITIN, SearchLocation.OVERRIDE])[0] == ResourceType.TPC
+
+
+def test_override_root_wins_over_subfolders(installation, cache_dir):
+    _write(os.path.join(installation.override_path(), "sub", "alpha.tpc"), b"sub")
+    _write(os.path.join(installation.override_path(), "sub", "beta.mdl"), b"sub")
+    _write(os.path.join(installation.override_path(), "alpha.tpc"), b"root")
+    index = ResourceIndex(installation, cache_dir)
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"root"
+    assert index.data("beta", ResourceType.MDL, OVERRIDE_FIRST) == b"sub"
+
+
+def test_earlier_capsules_win(installation, cache_dir, tmp_path):
+    first, second = str(tmp_path / "first.rim"), str(tmp_path / "second.mod")
+    _write(first, b"0123456789")
+    _write(second, b"abcdefghij")
+    index = ResourceIndex(installation, cache_dir)
+    index.set_capsules([FakeCapsule(first, [FakeResource("alpha", ResourceType.TPC, first, 1, 3)]),
+                        FakeCapsule(second, [FakeResource("alpha", ResourceType.TPC, second, 4, 2),
+                                             FakeResource("delta", ResourceType.MDL, second, 0, 3)])])
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"123"
+    assert index.data("delta", ResourceType.MDL, OVERRIDE_FIRST) == b"abc"
+
+    index.set_capsules([])
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"alpha"
+
+
+def test_refresh_follows_the_override_folder(installation, cache_dir):
+    index = ResourceIndex(installation, cache_dir, refresh_interval=0.0)
+    assert not index.refresh()
+
+    added = os.path.join(installation.override_path(), "sub", "alpha.tpc")
+    _write(added, b"added")
+    _touch_directory(os.path.dirname(added))
+    assert index.refresh()
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"added"
+
+    os.remove(added)
+    _touch_directory(os.path.dirname(added))
+    assert index.refresh()
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"alpha"
+
+
+def test_refresh_is_rate_limited(installation, cache_dir):
+    index = ResourceIndex(installation, cache_dir, refresh_interval=3600.0)
+    index.refresh()
+    _write(os.path.join(installation.override_path(), "alpha.tpc"), b"late")
+    _touch_directory(installation.override_path())
+    assert not index.refresh()
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"alpha"
+    assert index.refresh(force=True)
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"late"
+
+
+def test_saved_tables_are_reused_until_their_files_change(installation, cache_dir):
+    _write(os.path.join(installation.override_path(), "alpha.tpc"), b"override")
+    ResourceIndex(installation, cache_dir)
+    assert installation.chitin_scans == 1
+    assert len(os.listdir(cache_dir)) == 1
+
+    reopened = ResourceIndex(installation, cache_dir)
+    assert installation.chitin_scans == 1
+    assert reopened.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"override"
+
+    installation.chitin.insert(0, FakeResource("alpha", ResourceType.TPC, installation.bif, 7, 4))
+    _write(os.path.join(installation.root, "chitin.key"), b"key, rebuilt")
+    reopened = ResourceIndex(installation, cache_dir)
+    assert installation.chitin_scans == 2
+    assert reopened.data("alpha", ResourceType.TPC, [SearchLocation.CHITIN]) == b"BETA"
+
+
+def test_unreadable_cache_is_rebuilt(installation, cache_dir):
+    ResourceIndex(installation, cache_dir)
+    for name in os.listdir(cache_dir):
+        _write(os.path.join(cache_dir, name), b"{not json")
+    index = ResourceIndex(installation, cache_dir)
+    assert installation.chitin_scans == 2
+    assert index.data("alpha", ResourceType.TPC, OVERRIDE_FIRST) == b"alpha"
@@ -0,0 +1,72 @@
+"""
+Checks that releasing a scene gives back every GL object it created, judged by the report of the GLResources its
+AssetContext tracks them in. Needs PyOpenGL, PyGLM, PyKotor and an EGL driver; skipped where any is missing.
+"""
+from __future__ import annotations
+
+import importlib.util
+
+import pytest
+
+from pykotor.gl import headless
+
+for _module in ("OpenGL", "glm", "pykotor.common"):
+    try:
+        found = importlib.util.find_spec(_module) is not None
+    except ImportError:
+        found = False
+    if not found:
+        pytest.skip("{} is not installed".format(_module), allow_module_level=True)
+
+headless.configure()
+
+from pykotor.gl.assets import AssetContext
+from pykotor.gl.synthetic import SyntheticModule
+
+
+@pytest.fixture(scope="module")
+def context():
+    try:
+        context = headless.HeadlessContext(64, 64)
+    except Exception as error:
+        pytest.skip("no headless GL context: {}".format(error))
+    yield context
+    context.release()
+
+
+def _exercise(scene) -> None:
+    SyntheticModule(rooms=4, placeables=20, creatures=5, doors=5, triggers=2, waypoints=5).attach(scene)
+    scene.waitForPrefetch()
+    scene.render()
+    scene.waitForTextures()
+    scene.render()
+    scene.pick(32, 32)
+    scene.screenToWorld(32, 32)
+    scene.render()
+
+
+def test_released_scene_returns_to_baseline(context):
+    assets = AssetContext()
+    # Keeps the shaders and null texture alive, so the baseline holds what is shared as well as one scene's own
+    host = context.scene(assets=assets)
+    host.render()
+    baseline = host.resourceReport()
+
+    scene = context.scene(assets=assets)
+    _exercise(scene)
+    assert scene.resourceReport() != baseline
+    scene.release()
+
+    context.make_current()
+    assert host.resourceReport() == baseline
+    host.release()
+
+
+def test_last_scene_leaves_nothing(context):
+    assets = AssetContext()
+    scene = context.scene(assets=assets)
+    _exercise(scene)
+    scene.release()
+
+    assert assets.resources.report() == {}
+    assert assets.resources.pending() == 0
@@ -0,0 +1,146 @@
+"""
+Checks LooseOctree queries against brute force over random boxes, and that the tree follows items as they move and
+grows to fit items placed outside of it.
+"""
+from __future__ import annotations
+
+import math
+import random
+from typing import List, Tuple
+
+import pytest
+
+glm = pytest.importorskip("glm")
+from glm import vec3
+
+from pykotor.gl.spatial import LooseOctree
+
+
+class Box:
+    def __init__(self, low: vec3, high: vec3):
+        self.low: vec3 = low
+        self.high: vec3 = high
+
+
+def _bounds(box: Box) -> Tuple[vec3, vec3]:
+    return box.low, box.high
+
+
+def _random_box(rng: random.Random, extent: float = 500.0) -> Box:
+    center = vec3(rng.uniform(-extent, extent), rng.uniform(-extent, extent), rng.uniform(-extent / 10, extent / 10))
+    half = vec3(rng.uniform(0.1, 20.0), rng.uniform(0.1, 20.0), rng.uniform(0.1, 20.0))
+    return Box(center - half, center + half)
+
+
+def _overlaps(box: Box, low: vec3, high: vec3) -> bool:
+    return all(box.low[i] <= high[i] and box.high[i] >= low[i] for i in range(3))
+
+
+def _sphere_distance(box: Box, center: vec3) -> float:
+    return math.sqrt(sum(max(box.low[i] - center[i], 0.0, center[i] - box.high[i]) ** 2 for i in range(3)))
+
+
+def _ray_enter(box: Box, origin: vec3, direction: vec3) -> float:
+    near, far = 0.0, math.inf
+    for i in range(3):
+        if direction[i] == 0.0:
+            if origin[i] < box.low[i] or origin[i] > box.high[i]:
+                return math.inf
+            continue
+        t0, t1 = (box.low[i] - origin[i]) / direction[i], (box.high[i] - origin[i]) / direction[i]
+        near, far = max(near, min(t0, t1)), min(far, max(t0, t1))
+        if near > far:
+            return math.inf
+    return near
+
+
+@pytest.fixture
+def indexed() -> Tuple[LooseOctree, List[Box]]:
+    rng = random.Random(7)
+    boxes = [_random_box(rng) for _ in range(2000)]
+    tree = LooseOctree(_bounds)
+    for box in boxes:
+        tree.insert(box)
+    return tree, boxes
+
+
+def test_query_box_matches_brute_force(indexed):
+    tree, boxes = indexed
+    rng = random.Random(1)
+    for _ in range(50):
+        query = _random_box(rng)
+        expected = {id(box) for box in boxes if _overlaps(box, query.low, query.high)}
+        assert {id(box) for box in tree.query_box(query.low, query.high)} == expected
+
+
+def test_query_sphere_matches_brute_force(indexed):
+    tree, boxes = indexed
+    rng = random.Random(2)
+    for _ in range(50):
+        center = vec3(rng.uniform(-500, 500), rng.uniform(-500, 500), rng.uniform(-50, 50))
+        radius = rng.uniform(1.0, 100.0)
+        expected = {id(box) for box in boxes if _sphere_distance(box, center) <= radius}
+        assert {id(box) for box in tree.query_sphere(center, radius)} == expected
+
+
+def test_query_frustum_of_orthographic_camera_is_its_box(indexed):
+    tree, boxes = indexed
+    # With an identity view the orthographic frustum is the box x in [-100, 150], y in [-50, 200], z in [-60, -1]
+    projection = glm.ortho(-100.0, 150.0, -50.0, 200.0, 1.0, 60.0)
+    expected = {id(box) for box in boxes if _overlaps(box, vec3(-100, -50, -60), vec3(150, 200, -1))}
+    assert {id(box) for box in tree.query_frustum(projection)} == expected
+
+
+def test_query_ray_matches_brute_force_nearest_first(indexed):
+    tree, boxes = indexed
+    rng = random.Random(3)
+    for _ in range(20):
+        origin = vec3(rng.uniform(-600, 600), rng.uniform(-600, 600), rng.uniform(-60, 60))
+        direction = vec3(rng.uniform(-1, 1), rng.uniform(-1, 1), rng.uniform(-0.1, 0.1))
+        hits = tree.query_ray(origin, direction)
+        expected = {id(box) for box in boxes if _ray_enter(box, origin, direction) < math.inf}
+        assert {id(box) for _, box in hits} == expected
+        distances = [distance for distance, _ in hits]
+        assert distances == sorted(distances)
+        for distance, box in hits:
+            assert distance == pytest.approx(_ray_enter(box, origin, direction))
+
+
+def test_update_follows_moved_items(indexed):
+    tree, boxes = indexed
+    box = boxes[0]
+    old_low, old_high = vec3(box.low), vec3(box.high)
+    version = tree.version
+
+    box.low, box.high = vec3(4000, 4000, 0), vec3(4010, 4010, 10)
+    tree.update(box)
+    assert tree.version > version
+    assert box in tree.query_box(vec3(3990, 3990, -10), vec3(4020, 4020, 20))
+    assert box not in tree.query_box(old_low, old_high)
+    assert tree.bounds(box) == (4000, 4000, 0, 4010, 4010, 10)
+
+    tree.remove(box)
+    assert box not in tree
+    assert len(tree) == len(boxes) - 1
+    assert box not in tree.query_box(vec3(3990, 3990, -10), vec3(4020, 4020, 20))
+
+
+def test_grows_to_fit_distant_and_large_items():
+    tree = LooseOctree(_bounds, size=16.0, min_size=4.0)
+    near = Box(vec3(-1, -1, -1), vec3(1, 1, 1))
+    far = Box(vec3(-10000, 5000, 0), vec3(-9990, 5010, 10))
+    huge = Box(vec3(-50000, -50000, -50000), vec3(50000, 50000, 50000))
+    for box in (near, far, huge):
+        tree.insert(box)
+
+    assert len(tree) == 3
+    assert set(map(id, tree.query_box(vec3(-2, -2, -2), vec3(2, 2, 2)))) == {id(near), id(huge)}
+    assert set(map(id, tree.query_box(vec3(-10005, 5000, 0), vec3(-9995, 5005, 5)))) == {id(far), id(huge)}
+    assert set(map(id, tree.query_sphere(vec3(0, 0, 0), 1e6))) == {id(near), id(far), id(huge)}
+
+
+def test_clear_empties_the_tree(indexed):
+    tree, boxes = indexed
+    tree.clear()
+    assert len(tree) == 0
+    assert tree.query_box(vec3(-1000, -1000, -1000), vec3(1000, 1000, 1000)) == []
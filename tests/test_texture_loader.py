@@ -0,0 +1,58 @@
+"""
+Checks that TextureLoader hands back every requested load exactly once, honours the upload deadline and drops
+cancelled loads. Texture handles are stand-ins and the loads return strings in place of TPCs.
+"""
+from __future__ import annotations
+
+import threading
+import time
+
+from pykotor.gl.texture_loader import TextureLoader
+
+
+class FakeTexture:
+    pass
+
+
+def test_without_workers_it_is_synchronous():
+    assert not TextureLoader({}, 0).asynchronous()
+
+
+def test_waiting_yields_every_load_once():
+    pending = {}
+    loader = TextureLoader(pending, 2)
+    textures = [FakeTexture() for _ in range(5)]
+    for index, texture in enumerate(textures):
+        loader.request(texture, str, index)
+
+    finished = dict(loader.finished())
+    assert finished == {texture: str(index) for index, texture in enumerate(textures)}
+    assert pending == {}
+    assert list(loader.finished()) == []
+    loader.shutdown()
+
+
+def test_deadline_skips_unfinished_loads():
+    loader = TextureLoader({}, 2)
+    release = threading.Event()
+    slow, fast = FakeTexture(), FakeTexture()
+    loader.request(slow, release.wait)
+    loader.request(fast, str, "fast")
+    while not loader.pending[fast].done():
+        time.sleep(0.001)
+
+    assert list(loader.finished(time.perf_counter() - 1.0)) == []
+    assert list(loader.finished(time.perf_counter() + 60.0)) == [(fast, "fast")]
+    assert list(loader.pending) == [slow]
+    release.set()
+    assert list(loader.finished()) == [(slow, True)]
+    loader.shutdown()
+
+
+def test_cancelled_loads_are_dropped():
+    loader = TextureLoader({}, 1)
+    texture = FakeTexture()
+    loader.request(texture, str, "cancelled")
+    loader.cancel(texture)
+    assert list(loader.finished()) == []
+    loader.shutdown()
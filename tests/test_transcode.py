@@ -0,0 +1,181 @@
+"""
+Round trips images through the DXT1/DXT5 encoders and a reference decoder written from the S3TC specification, and
+checks the mip chains and the disk cache of TextureTranscoder.
+"""
+from __future__ import annotations
+
+import os
+
+import numpy
+import pytest
+
+pytest.importorskip("pykotor.resource.formats.tpc")
+from pykotor.resource.formats.tpc import TPC, TPCTextureFormat
+
+from pykotor.gl.transcode import CompressedTPC, TextureTranscoder, compress_dxt1, compress_dxt5, downsample
+
+
+def _expand_565(packed: numpy.ndarray) -> numpy.ndarray:
+    packed = packed.astype(numpy.int32)
+    r, g, b = (packed >> 11) & 0x1F, (packed >> 5) & 0x3F, packed & 0x1F
+    return numpy.stack([(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)], -1).astype(numpy.float64)
+
+
+def _decode_color(blocks: numpy.ndarray, four_color_only: bool) -> numpy.ndarray:
+    """
+    Decodes an array of 8 byte color blocks to an array of shape (blocks, 16, 3).
+    """
+    c0 = blocks[:, 0].astype(numpy.uint16) | blocks[:, 1].astype(numpy.uint16) << 8
+    c1 = blocks[:, 2].astype(numpy.uint16) | blocks[:, 3].astype(numpy.uint16) << 8
+    indices = blocks[:, 4:8].copy().view("<u4")[:, 0]
+    e0, e1 = _expand_565(c0), _expand_565(c1)
+    four = (c0 > c1)[:, None] | four_color_only
+    palette = numpy.stack([e0, e1, numpy.where(four, (2 * e0 + e1) / 3, (e0 + e1) / 2),
+                           numpy.where(four, (e0 + 2 * e1) / 3, 0.0)], 1)
+    selectors = (indices[:, None] >> (numpy.arange(16, dtype=numpy.uint32) * 2)) & 3
+    return numpy.take_along_axis(palette, selectors[..., None].astype(numpy.int64), 1)
+
+
+def _decode_alpha(blocks: numpy.ndarray) -> numpy.ndarray:
+    """
+    Decodes an array of 8 byte DXT5 alpha blocks to an array of shape (blocks, 16).
+    """
+    a0, a1 = blocks[:, 0].astype(numpy.float64), blocks[:, 1].astype(numpy.float64)
+    bits = numpy.zeros(len(blocks), numpy.uint64)
+    for i in range(6):
+        bits |= blocks[:, 2 + i].astype(numpy.uint64) << numpy.uint64(8 * i)
+    eight = (a0 > a1)[:, None]
+    steps = numpy.arange(1, 7, dtype=numpy.float64)
+    interpolated8 = ((7 - steps) * a0[:, None] + steps * a1[:, None]) / 7
+    interpolated6 = ((5 - steps[:4]) * a0[:, None] + steps[:4] * a1[:, None]) / 5
+    six = numpy.concatenate([interpolated6, numpy.zeros((len(blocks), 1)), numpy.full((len(blocks), 1), 255.0)], 1)
+    palette = numpy.concatenate([a0[:, None], a1[:, None], numpy.where(eight, interpolated8, six)], 1)
+    selectors = (bits[:, None] >> (numpy.arange(16, dtype=numpy.uint64) * numpy.uint64(3))) & numpy.uint64(7)
+    return numpy.take_along_axis(palette, selectors.astype(numpy.int64), 1)
+
+
+def _unblock(pixels: numpy.ndarray, height: int, width: int) -> numpy.ndarray:
+    rows, columns = (height + 3) // 4, (width + 3) // 4
+    channels = pixels.shape[-1]
+    image = pixels.reshape(rows, columns, 4, 4, channels).transpose(0, 2, 1, 3, 4)
+    return image.reshape(rows * 4, columns * 4, channels)[:height, :width]
+
+
+def decode_dxt1(data: bytes, height: int, width: int) -> numpy.ndarray:
+    blocks = numpy.frombuffer(data, numpy.uint8).reshape(-1, 8)
+    return _unblock(_decode_color(blocks, False), height, width)
+
+
+def decode_dxt5(data: bytes, height: int, width: int) -> numpy.ndarray:
+    blocks = numpy.frombuffer(data, numpy.uint8).reshape(-1, 16)
+    color = _decode_color(blocks[:, 8:], True)
+    alpha = _decode_alpha(blocks[:, :8])
+    return _unblock(numpy.concatenate([color, alpha[..., None]], -1), height, width)
+
+
+def smooth_image(height: int, width: int, channels: int, seed: int = 0) -> numpy.ndarray:
+    """
+    Returns slow waves with some noise, which compress like real textures do rather than like white noise.
+    """
+    rng = numpy.random.default_rng(seed)
+    y, x = numpy.mgrid[0:height, 0:width]
+    image = numpy.stack([128 + 100 * numpy.sin(x / 7 + channel) * numpy.cos(y / 9 - channel)
+                         for channel in range(channels)], -1)
+    return numpy.clip(image + rng.normal(0, 2, image.shape), 0, 255).astype(numpy.uint8)
+
+
+@pytest.mark.parametrize("height, width", [(64, 64), (32, 128), (4, 4), (6, 10), (1, 1)])
+def test_dxt1_round_trip(height, width):
+    image = smooth_image(height, width, 3)
+    data = compress_dxt1(image)
+    assert len(data) == (height + 3) // 4 * ((width + 3) // 4) * 8
+
+    decoded = decode_dxt1(data, height, width)
+    error = numpy.abs(decoded - image)
+    # 565 endpoints and four colors per block cost about five levels on average, more in a lone block
+    assert error.mean() < 8.0
+    assert error.max() < 40.0
+
+
+@pytest.mark.parametrize("height, width", [(64, 64), (16, 8), (6, 10)])
+def test_dxt5_round_trip(height, width):
+    image = smooth_image(height, width, 4, seed=1)
+    data = compress_dxt5(image)
+    assert len(data) == (height + 3) // 4 * ((width + 3) // 4) * 16
+
+    decoded = decode_dxt5(data, height, width)
+    error = numpy.abs(decoded - image)
+    assert error[..., :3].mean() < 8.0
+    assert error[..., 3].max() <= 255 / 14 + 1
+
+
+def test_solid_blocks_are_exact_up_to_565():
+    image = numpy.empty((8, 8, 3), numpy.uint8)
+    image[...] = (200, 100, 50)
+    decoded = decode_dxt1(compress_dxt1(image), 8, 8)
+    # Five bit channels lose up to 7 levels and six bit channels up to 3
+    assert numpy.all(numpy.abs(decoded - image) <= (7, 3, 7))
+    assert numpy.all(decoded == decoded[0, 0])
+
+
+def test_two_level_alpha_is_exact():
+    image = numpy.full((8, 8, 4), 128, numpy.uint8)
+    image[..., 3] = 0
+    image[::2, ::3, 3] = 255
+    decoded = decode_dxt5(compress_dxt5(image), 8, 8)
+    assert numpy.array_equal(decoded[..., 3], image[..., 3])
+
+
+def test_downsample_averages_and_rounds_down_odd_sizes():
+    image = numpy.array([[[0], [4], [9]], [[8], [12], [9]], [[1], [1], [1]]], numpy.uint8)
+    assert downsample(image).tolist() == [[[6]]]
+    assert downsample(numpy.full((1, 5, 3), 10, numpy.uint8)).shape == (1, 2, 3)
+    assert downsample(numpy.full((1, 1, 3), 10, numpy.uint8)).tolist() == [[[10, 10, 10]]]
+
+
+def _tpc(size: int, texture_format: TPCTextureFormat, levels: int = 1) -> TPC:
+    channels = 3 if texture_format == TPCTextureFormat.RGB else 4
+    image = smooth_image(size, size, channels, seed=2)
+    mipmaps = []
+    for _ in range(levels):
+        mipmaps.append(image.tobytes())
+        image = downsample(image)
+    tpc = TPC()
+    tpc.set(size, size, mipmaps, texture_format)
+    return tpc
+
+
+@pytest.mark.parametrize("texture_format, compressed_format", [(TPCTextureFormat.RGB, TPCTextureFormat.DXT1),
+                                                               (TPCTextureFormat.RGBA, TPCTextureFormat.DXT5)])
+def test_transcoder_builds_a_full_mip_chain(tmp_path, texture_format, compressed_format):
+    transcoded = TextureTranscoder(str(tmp_path)).transcode(_tpc(32, texture_format, levels=2))
+    assert isinstance(transcoded, CompressedTPC)
+    assert transcoded.format == compressed_format
+    assert transcoded.mipmap_count() == 6
+    assert [transcoded.get(level)[:2] for level in range(6)] == [(32 >> level, 32 >> level) for level in range(6)]
+
+    decode = decode_dxt1 if compressed_format == TPCTextureFormat.DXT1 else decode_dxt5
+    width, height, _, data = transcoded.get(0)
+    source = numpy.frombuffer(_tpc(32, texture_format).get(0)[3], numpy.uint8).reshape(height, width, -1)
+    assert numpy.abs(decode(data, height, width) - source)[..., :3].mean() < 8.0
+
+
+def test_transcoder_reads_its_cache(tmp_path, monkeypatch):
+    tpc = _tpc(16, TPCTextureFormat.RGBA)
+    first = TextureTranscoder(str(tmp_path)).transcode(tpc)
+    assert [name for name in os.listdir(tmp_path) if name.endswith(".bcn")]
+
+    def fail(*args):
+        raise AssertionError("compressed again instead of read from the cache")
+
+    monkeypatch.setattr(TextureTranscoder, "_compress", staticmethod(fail))
+    second = TextureTranscoder(str(tmp_path)).transcode(tpc)
+    assert (second.width, second.height, second.format) == (first.width, first.height, first.format)
+    assert second.mipmaps == first.mipmaps
+
+
+def test_compressed_textures_pass_through(tmp_path):
+    tpc = TPC()
+    tpc.set(4, 4, [bytes(8)], TPCTextureFormat.DXT1)
+    assert TextureTranscoder(str(tmp_path)).transcode(tpc) is tpc
+    assert os.listdir(tmp_path) == []